@@ -0,0 +1,243 @@
+/*
+ * autopilot.c
+ *
+ * Computer player for the pac-man - see autopilot.h
+ */
+
+#include <stdlib.h>
+
+#include "autopilot.h"
+#include "game.h"
+#include "bitboard.h"
+#include "scratch.h"
+#include "timer1.h"
+
+// Longest the search queue can get. The search spreads out along the
+// corridors of the maze (from the pac-man and the ghosts) so only a few 
+// cells are waiting at any time (at most 33 over 200 games). If the queue
+// is full, cells are left out of the search. It is on the stack (3 bytes
+// a cell) so it is kept small.
+#define SEARCH_QUEUE_SIZE 40
+
+// first_direction of the cells the ghosts get to
+#define GHOST_SEARCH 0xFF
+
+// Game ticks (ms) after which we search again even if the pac-man hasn't
+// moved, since the ghosts will have moved
+#define SEARCH_INTERVAL 100
+
+typedef struct {
+	uint8_t x;
+	uint8_t y;
+	uint8_t first_direction;	// Direction of the pac-man's first move to get
+								// here, or GHOST_SEARCH
+} SearchCell;
+
+// Where the pac-man and the ghosts were and when the last search was done
+static uint8_t last_x;
+static uint8_t last_y;
+static uint8_t last_ghost_x[NUM_GHOSTS];
+static uint8_t last_ghost_y[NUM_GHOSTS];
+static uint32_t last_search_tick;
+
+// A pac-dot or power pellet to head towards when there is nothing within
+// reach of the search. goal_needed is set when the last search didn't
+// find anything.
+static uint8_t goal_x;
+static uint8_t goal_y;
+static uint8_t goal_needed;
+
+static uint16_t num_searches;
+static uint16_t max_search_time;
+
+// Returns 1 if there is something at (x,y) worth heading for
+static int8_t is_target_at(uint8_t x, uint8_t y) {
+	if(is_pacdot_at(x, y) || is_pellet_at(x, y)) {
+		return 1;
+	}
+	for(int8_t i = 0; i < NUM_GHOSTS; i++) {
+		if(is_ghost_frightened(i) && get_ghost_x(i) == x && get_ghost_y(i) == y) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Make sure the goal is something still to be eaten. If it isn't, the 
+// nearest pac-dot or power pellet (in rows plus columns) is the new goal.
+// This looks at the whole field, so is only done when the pac-dots are
+// thin on the ground (and then only when the goal has been eaten).
+static void update_goal(uint8_t x, uint8_t y) {
+	int16_t best_distance = FIELD_WIDTH + FIELD_HEIGHT;
+	if(is_pacdot_at(goal_x, goal_y) || is_pellet_at(goal_x, goal_y)) {
+		return;
+	}
+	for(uint8_t goal_row = 0; goal_row < FIELD_HEIGHT; goal_row++) {
+		for(uint8_t goal_column = 0; goal_column < FIELD_WIDTH; goal_column++) {
+			int16_t distance = abs(goal_column - x) + abs(goal_row - y);
+			if(distance < best_distance && 
+					(is_pacdot_at(goal_column, goal_row) || is_pellet_at(goal_column, goal_row))) {
+				best_distance = distance;
+				goal_x = goal_column;
+				goal_y = goal_row;
+			}
+		}
+	}
+}
+
+// Pick the direction that gets furthest away from the nearest ghost which
+// isn't frightened. Returns -1 if the pac-man can't move at all.
+static int8_t run_away(uint8_t x, uint8_t y) {
+	int8_t best_direction = -1;
+	int16_t best_distance = -1;
+	uint8_t new_x, new_y;
+	for(int8_t direction = 0; direction < NUM_DIRECTION_VALUES; direction++) {
+		if(!cell_in_dirn(x, y, direction, &new_x, &new_y) || is_wall_at(new_x, new_y)) {
+			continue;
+		}
+		int16_t nearest = FIELD_WIDTH + FIELD_HEIGHT;
+		for(int8_t i = 0; i < NUM_GHOSTS; i++) {
+			if(!is_ghost_frightened(i)) {
+				int16_t distance = abs(get_ghost_x(i) - new_x) + abs(get_ghost_y(i) - new_y);
+				if(distance < nearest) {
+					nearest = distance;
+				}
+			}
+		}
+		if(nearest > best_distance) {
+			best_distance = nearest;
+			best_direction = direction;
+		}
+	}
+	return best_direction;
+}
+
+// Add a cell to the end of the search queue (if it's not full), blocking
+// it so that it isn't searched again
+static void queue_cell(SearchCell* queue, uint8_t queue_start, uint8_t* queue_length, 
+		uint8_t x, uint8_t y, uint8_t first_direction) {
+	if(*queue_length < SEARCH_QUEUE_SIZE) {
+		bitboard_set(scratch.rows[y], x);
+		SearchCell* cell = &queue[(queue_start + (*queue_length)++) % SEARCH_QUEUE_SIZE];
+		cell->x = x;
+		cell->y = y;
+		cell->first_direction = first_direction;
+	}
+}
+
+// Queue the cells next to (x,y) that can be moved into and haven't been
+// searched yet
+static void queue_neighbours(SearchCell* queue, uint8_t queue_start, uint8_t* queue_length,
+		uint8_t x, uint8_t y, uint8_t first_direction, int8_t from_pacman) {
+	uint8_t new_x, new_y;
+	for(int8_t direction = 0; direction < NUM_DIRECTION_VALUES; direction++) {
+		if(cell_in_dirn(x, y, direction, &new_x, &new_y) && 
+				!is_wall_at(new_x, new_y) && !bitboard_test(scratch.rows[new_y], new_x)) {
+			// The first move of a path from the pac-man is the direction
+			queue_cell(queue, queue_start, queue_length, new_x, new_y, 
+					from_pacman ? direction : first_direction);
+		}
+	}
+}
+
+// Search outwards from (x,y) for the nearest target. The ghosts which 
+// aren't frightened search outwards at the same time (with a head start
+// of AUTOPILOT_DANGER_DISTANCE cells) and any cell a ghost gets to first 
+// is avoided. Returns the direction of the first move towards the target.
+// If nothing is found within AUTOPILOT_MAX_CELLS cells we head for the 
+// cell we got to that is nearest the goal, or return -1 if the ghosts get
+// everywhere first. The cells already reached (from the pac-man or a ghost)
+// are blocked in the scratch RAM - bitboard rows as for the walls - which
+// autopilot_direction() clears first.
+static int8_t search(uint8_t x, uint8_t y) {
+	SearchCell queue[SEARCH_QUEUE_SIZE];
+	uint8_t queue_start = 0, queue_length = 0;
+	int8_t direction = -1;
+	int16_t best_distance = FIELD_WIDTH + FIELD_HEIGHT;
+
+	for(int8_t i = 0; i < NUM_GHOSTS; i++) {
+		if(!is_ghost_frightened(i)) {
+			queue_cell(queue, queue_start, &queue_length, get_ghost_x(i), get_ghost_y(i), GHOST_SEARCH);
+		}
+	}
+	// Give the ghosts their head start, a whole distance at a time
+	for(uint8_t distance = 0; distance < AUTOPILOT_DANGER_DISTANCE; distance++) {
+		for(uint8_t cells = queue_length; cells > 0; cells--) {
+			SearchCell cell = queue[queue_start];
+			queue_start = (queue_start + 1) % SEARCH_QUEUE_SIZE;
+			queue_length--;
+			queue_neighbours(queue, queue_start, &queue_length, cell.x, cell.y, GHOST_SEARCH, 0);
+		}
+	}
+	if(bitboard_test(scratch.rows[y], x)) {
+		// A ghost is already (nearly) here
+		return -1;
+	}
+	bitboard_set(scratch.rows[y], x);
+	queue_neighbours(queue, queue_start, &queue_length, x, y, 0, 1);
+
+	for(uint8_t cells = 0; cells < AUTOPILOT_MAX_CELLS && queue_length > 0; cells++) {
+		SearchCell cell = queue[queue_start];
+		queue_start = (queue_start + 1) % SEARCH_QUEUE_SIZE;
+		queue_length--;
+		if(cell.first_direction != GHOST_SEARCH) {
+			if(is_target_at(cell.x, cell.y)) {
+				goal_needed = 0;
+				return cell.first_direction;
+			}
+			int16_t distance = abs(cell.x - goal_x) + abs(cell.y - goal_y);
+			if(distance < best_distance) {
+				best_distance = distance;
+				direction = cell.first_direction;
+			}
+		}
+		queue_neighbours(queue, queue_start, &queue_length, cell.x, cell.y, cell.first_direction, 0);
+	}
+	goal_needed = 1;
+	return direction;
+}
+
+int8_t autopilot_direction(void) {
+	uint8_t x = get_pacman_x();
+	uint8_t y = get_pacman_y();
+	uint16_t start_time;
+	int8_t direction;
+	int8_t moved = (x != last_x || y != last_y);
+
+	for(int8_t i = 0; i < NUM_GHOSTS; i++) {
+		if(get_ghost_x(i) != last_ghost_x[i] || get_ghost_y(i) != last_ghost_y[i]) {
+			moved = 1;
+			last_ghost_x[i] = get_ghost_x(i);
+			last_ghost_y[i] = get_ghost_y(i);
+		}
+	}
+	if(is_game_over() || (!moved && get_game_ticks() - last_search_tick < SEARCH_INTERVAL)) {
+		return -1;
+	}
+	start_time = get_timer1_count();
+	last_x = x;
+	last_y = y;
+	last_search_tick = get_game_ticks();
+
+	for(uint8_t row = 0; row < FIELD_HEIGHT; row++) {
+		bitboard_clear_row(scratch.rows[row]);
+	}
+	if(goal_needed) {
+		update_goal(x, y);
+	}
+	direction = search(x, y);
+	if(direction < 0) {
+		direction = run_away(x, y);
+	}
+
+	num_searches++;
+	if((uint16_t)(get_timer1_count() - start_time) > max_search_time) {
+		max_search_time = get_timer1_count() - start_time;
+	}
+	return direction;
+}
+
+void get_autopilot_stats(uint16_t* searches, uint16_t* max_time) {
+	*searches = num_searches;
+	*max_time = max_search_time;
+}
@@ -0,0 +1,36 @@
+/*
+ * autopilot.h
+ *
+ * A computer player for the pac-man. It heads for the nearest pac-dot or 
+ * power pellet (or frightened ghost) that it can get to before a ghost 
+ * can, found by a breadth first search from the pac-man and the ghosts at
+ * the same time. The search stops after AUTOPILOT_MAX_CELLS cells so that
+ * it takes a bounded time - if nothing is found by then it heads towards 
+ * the nearest pac-dot as the crow flies. If the ghosts can get everywhere
+ * first it runs from the nearest ghost.
+ */
+
+#ifndef AUTOPILOT_H_
+#define AUTOPILOT_H_
+
+#include <stdint.h>
+
+// Most cells looked at in one search
+#define AUTOPILOT_MAX_CELLS 96
+
+// Number of cells head start the ghosts which aren't frightened get in the
+// search, i.e. how close they can get before a path is avoided
+#define AUTOPILOT_DANGER_DISTANCE 2
+
+// Return the direction the pac-man should go in (to pass to 
+// change_pacman_direction()) or -1 if there is nothing new to decide. A 
+// search is only done when the pac-man has moved to a new cell or a ghost
+// has had time to move since the last search, so this can be called on 
+// every pass of the main loop.
+int8_t autopilot_direction(void);
+
+// Get the number of searches done and the longest time (in timer 1 counts,
+// i.e. microseconds) one has taken
+void get_autopilot_stats(uint16_t* searches, uint16_t* max_time);
+
+#endif /* AUTOPILOT_H_ */
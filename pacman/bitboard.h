@@ -0,0 +1,77 @@
+/*
+ * bitboard.h
+ *
+ * Each row of the game field can be stored as a bitboard - one bit per
+ * column, bit x (counting from the least significant bit of the first
+ * word) for column x. A row is as many 32 bit words as it takes to hold
+ * FIELD_WIDTH bits, so the field size can be changed at compile time 
+ * (see game.h). When a row fits in a single word (FIELD_WIDTH <= 32, as 
+ * for the standard 31 column field) the functions below compile down to 
+ * a single shift and mask, exactly as if the row were a plain uint32_t.
+ * Any unused bits at the end of a row are always 0.
+ */
+
+#ifndef BITBOARD_H_
+#define BITBOARD_H_
+
+#include <stdint.h>
+#include "game.h"
+
+#define BITBOARD_WORD_BITS 32
+#define BITBOARD_ROW_WORDS ((FIELD_WIDTH + BITBOARD_WORD_BITS - 1) / BITBOARD_WORD_BITS)
+
+typedef uint32_t BitboardRow[BITBOARD_ROW_WORDS];
+
+#if BITBOARD_ROW_WORDS == 1
+#define BITBOARD_WORD(x) 0
+#define BITBOARD_MASK(x) (1UL << (x))
+#else
+#define BITBOARD_WORD(x) ((x) / BITBOARD_WORD_BITS)
+#define BITBOARD_MASK(x) (1UL << ((x) % BITBOARD_WORD_BITS))
+#endif
+
+// Returns 1 if the bit for column x is set in the given row, 0 otherwise
+static inline uint8_t bitboard_test(const uint32_t* row, uint8_t x) {
+	return (row[BITBOARD_WORD(x)] & BITBOARD_MASK(x)) ? 1 : 0;
+}
+
+// Set or clear the bit for column x in the given row
+static inline void bitboard_set(uint32_t* row, uint8_t x) {
+	row[BITBOARD_WORD(x)] |= BITBOARD_MASK(x);
+}
+
+static inline void bitboard_clear(uint32_t* row, uint8_t x) {
+	row[BITBOARD_WORD(x)] &= ~BITBOARD_MASK(x);
+}
+
+// Clear every bit in the given row
+static inline void bitboard_clear_row(uint32_t* row) {
+	for(uint8_t i = 0; i < BITBOARD_ROW_WORDS; i++) {
+		row[i] = 0;
+	}
+}
+
+// Number of bits set in a byte / word
+static inline uint8_t bitboard_count_byte(uint8_t b) {
+	b = b - ((b >> 1) & 0x55);
+	b = (b & 0x33) + ((b >> 2) & 0x33);
+	return (b + (b >> 4)) & 0x0F;
+}
+
+static inline uint8_t bitboard_count_word(uint32_t word) {
+	return bitboard_count_byte(word) + bitboard_count_byte(word >> 8)
+			+ bitboard_count_byte(word >> 16) + bitboard_count_byte(word >> 24);
+}
+
+// Returns the number of bits set in the given row for columns 0 to x-1
+static inline uint8_t bitboard_count_below(const uint32_t* row, uint8_t x) {
+	uint8_t count = 0;
+#if BITBOARD_ROW_WORDS > 1
+	for(uint8_t i = 0; i < BITBOARD_WORD(x); i++) {
+		count += bitboard_count_word(row[i]);
+	}
+#endif
+	return count + bitboard_count_word(row[BITBOARD_WORD(x)] & (BITBOARD_MASK(x) - 1));
+}
+
+#endif /* BITBOARD_H_ */
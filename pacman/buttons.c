@@ -69,6 +69,10 @@ int8_t button_pushed(void) {
 	return return_value;
 }
 
+uint8_t button_pushes_waiting(void) {
+	return queue_length;
+}
+
 // Interrupt handler for a change on buttons
 ISR(PCINT1_vect) {
 	// Get the current state of the buttons. We'll compare this with
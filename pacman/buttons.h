@@ -30,5 +30,10 @@ void init_button_interrupts(void);
 
 int8_t button_pushed(void);
 
+/* Return the number of button pushes waiting to be returned by
+ * button_pushed(). (Can be called with interrupts off.)
+ */
+uint8_t button_pushes_waiting(void);
+
 
 #endif /* BUTTONS_H_ */
\ No newline at end of file
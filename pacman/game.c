@@ -6,89 +6,96 @@
 */
 
 #include "game.h"
-#include <stdio.h>
-#include "ledmatrix.h"
-#include "terminalio.h"
-#include "line_drawing_characters.h"
-#include "pixel_colour.h"
 #include <avr/pgmspace.h>
 #include <stdlib.h>
 #include "score.h"
 #include "timer0.h"
-/* Stdlib needed for random() - random number generator */
-///////////////////////////////////////////////////////////
-// Initial game field
-// The string below has 31 elements for each of the 31 rows. The index into 
-// the string is row_number * 31 + column_number.
-// Each location is one of the following values:
-// (space) - nothing at this location
-// - - horizontal wall at this location - uses LINE_HORIZONTAL
-// | - vertical wall at this location - uses LINE_VERTICAL
-// F - wall is down and to the right - uses LINE_DOWN_AND_RIGHT
-// 7 - wall is down and to the left - uses LINE_DOWN_AND_LEFT
-// L - wall is up and to the right - uses LINE_UP_AND_RIGHT
-// J - wall is up and to the left - uses LINE_UP_AND_LEFT
-// > - wall is vertical and to the right - uses LINE_VERTICAL_AND_RIGHT
-// < - wall is vertical and to the left - uses LINE_VERTICAL_AND_LEFT
-// ^ - wall is horizontal and up - uses LINE_HORIZONTAL_AND_UP
-// v - wall is horizontal and down - uses LINE_HORIZONTAL_AND_DOWN
-// + - wall is in all directions - uses LINE_VERTICAL_AND_HORIZONTAL
-// . - pacdot initially at this location
-// P - power pellet initial location (initially implemented just as a pac-dot)
-//
-// This array is stored in program memory to preserve RAM. (1 is added to 
-// size to allow for null character at end of string.)
-// (Note that string constants with whitespace between them are concatenated.)
-
-static const char init_game_field[FIELD_HEIGHT*FIELD_WIDTH + 1] PROGMEM =
-	"F-------------v-v-------------7"
-	"|.............| |.............|"
-	"|.F---7.F---7.| |.F---7.F---7.|"
-	"|.|   |.L---J.L-J.L---J.|   |.|"
-	"|.|   |.................|   |.|"
-	"|.|   |.F---7.F-7.F---7.|   |.|"
-	"|PL---J.L---J.L-J.L---J.L---JP|"
-	"|.............................|"
-	"|.F---7.F7.F-------7.F7.F---7.|"
-	"|.L---J.||.L--7 F--J.||.L---J.|"
-	"|.......||....| |....||.......|"
-	"L-----7.|L--7 | | F--J|.F-----J"
-	"      |.|F--J L-J L--7|.|      "
-	"      |.||           ||.|      "
-	"------J.LJ F--   --7 LJ.L------"
-	"       .   |       |   .       "
-	"------7.F7 L-------J F7.F------"
-	"      |.||           ||.|      "
-	"      |.|| F-------7 ||.|      "
-	"F-----J.LJ L--7 F--J LJ.L-----7"
-	"|.............| |.............|"
-	"|.F---7.F---7.| |.F---7.F---7.|"
-	"|.L-7 |.L---J.L-J.L---J.| F-J.|"
-	"|P..| |........ ........| |..P|"
-	">-7.| |.F7.F-------7.F7.| |.F-<"
-	">-J.L-J.||.L--7 F--J.||.L-J.L-<"
-	"|.......||....| |....||.......|"
-	"|.F-----JL--7.| |.F--JL-----7.|"
-	"|.L---------J.L-J.L---------J.|"
-	"|.............................|"
-	"L-----------------------------J";
-
-// Array to store the game dots (pacdots) - each element in the array is a 32 bit integer, 
-// representing the absence/presence of pacdots in each row. The first element in 
-// the array is for row 0 (top), the last for row 30 (bottom).
-// Within the 32-bit integer, the least significant 31 bits are used to store
-// the data for each column in that row. The least significant bit (bit 0) is the value
-// for column 0 (left hand column), the second most significant bit (bit 30) is for
-// column 30 (right hand column). The most significant bit (bit 31) is unused. A value
-// of 1 in a bit represents the presence of a pacdot, 0 is the absence.
+#include "timer1.h"
+#include "levels.h"
+#include "maze.h"
+#include "bitboard.h"
+#include "ghost_search.h"
+/* Stdlib needed for abs() (and random() - only used, in a 
+ * RANDOM_COST_BENCH build, to compare against our own random number
+ * generator below) */
+
+// The current level number (0 is the first level) and the definition of
+// the level being played (in program memory). All maze and level details
+// are read through current_level - nothing is copied to RAM.
+static uint8_t level_number;
+static const LevelDefinition* current_level;
+static const uint8_t* game_field;
+static const uint16_t* game_field_cells;
+#define LEVEL_DATA(member) pgm_read_byte(&current_level->member)
+
+// Speeds and difficulty for this level (in program memory)
+static const LevelSpeeds* current_speeds;
+#define SPEED_DATA(member) pgm_read_word(&current_speeds->member)
+
+// Game time (ms). This follows the clock from timer 0 but is only moved on
+// by advance_game_time() so everything that happens in the game depends 
+// only on the game time, not on when the main loop gets around to it.
+static uint32_t game_time;
+
+// Number of milliseconds of game time since the game started (i.e. the 
+// number of calls to advance_game_time()). Unlike the game time this
+// doesn't jump when a new level starts.
+static uint32_t game_ticks;
+
+// Each of the pac-man and the ghosts has a progress value - how far (in
+// 1/65536ths of a cell) it is towards the next cell. Every millisecond of 
+// game time its speed is added and it moves when this passes a whole cell.
+// Any fraction left over is kept so there is no drift.
+static uint16_t pacman_progress;
+static uint16_t ghost_progress[NUM_GHOSTS];
+
+// Random number generator state. Frightened ghosts move at random and the
+// random numbers come from a 16 bit xorshift generator rather than the C 
+// library random() which is much slower on the AVR (32 bit multiplies and
+// divides). The state is part of the game state so a game can be replayed
+// exactly by starting it with the same state. It must never be 0.
+static uint16_t random_state = 1;
+
+static inline uint16_t next_random(void) {
+	uint16_t x = random_state;
+	x ^= x << 7;
+	x ^= x >> 9;
+	x ^= x << 8;
+	random_state = x;
+	return x;
+}
+
+// Array to store the walls - each element in the array is a bitboard row (see 
+// bitboard.h), representing the absence/presence of walls in each row. The first 
+// element in the array is for row 0 (top), the last for row FIELD_HEIGHT-1 
+// (bottom). Within the row, bit 0 is the value for column 0 (left hand column) 
+// and bit FIELD_WIDTH-1 for the right hand column. With the standard 31 column 
+// field each row is a single 32 bit integer and the most significant bit (bit 31)
+// is unused. A value of 1 in a bit represents the presence of a wall, 0 is the 
+// absence. The maze is stored compressed so this is how we find out quickly 
+// whether there is a wall at a given location.
+static BitboardRow walls[FIELD_HEIGHT];
+
+// Only the walkable cells (those which aren't walls) can hold pac-dots and 
+// power pellets so these are stored one bit per walkable cell, using the 
+// walkable cell index (see cell_index() below). Bit (n % 8) of edibles[n / 8]
+// is 1 if walkable cell n holds a pac-dot or power pellet that hasn't been
+// eaten yet. The power pellets are told apart by their cell indexes, which
+// are kept in pellet_cells. 
 //
-// This array will be initially set from the data in init_game_field above and
-// will be updated as pacdots are eaten.
-static uint32_t pacdots[FIELD_HEIGHT];
-static uint32_t pellets[FIELD_HEIGHT]; 
+// These arrays will be initially set from the data in the level's game field 
+// and will be updated as pacdots and pellets are eaten.
+static uint8_t edibles[(MAX_WALKABLE_CELLS + 7) / 8];
+static uint16_t pellet_cells[MAX_PELLETS];
+static uint8_t num_pellets;
 // We also keep a count of the number of pac-dots remaining on the game field
 static uint16_t num_pacdots;
 
+// Size (bytes) of the compressed maze for this level and the time (timer 1
+// counts, i.e. microseconds) it took to decode it into the arrays above
+static uint16_t maze_encoded_size;
+static uint16_t maze_decode_time;
+
 //Lives of pacman (player)
 static uint8_t lives; 
 
@@ -99,24 +106,61 @@ static uint32_t powerup_time_start = 0 ;
 uint8_t powerup = 0;
 
 //Ghost eat counter(1= 200pts  ,2 = 400 pts, 3= 800 pts ,4= 1600pts)
-uint16_t ghost_eat = 0 ; 
+uint16_t ghost_eat = 0 ;
+
+// Ghost behaviour modes. The ghosts alternate between SCATTER (head for
+// their own corner of the field) and CHASE (head for a target tile worked
+// out from the pac-man position) according to ghost_mode_schedule below.
+// Eating a power pellet makes the ghosts frightened for a while (which 
+// depends on the level), during which they wander randomly and the schedule 
+// is suspended.
+#define GHOST_MODE_SCATTER 0
+#define GHOST_MODE_CHASE 1
+
+// Each phase of the schedule is a mode and how long (ms of game time) it
+// lasts. A duration of 0 means the phase lasts until the end of the level.
+typedef struct {
+	uint8_t mode;
+	uint16_t duration;
+} GhostModePhase;
+
+static const GhostModePhase ghost_mode_schedule[] PROGMEM = {
+	{GHOST_MODE_SCATTER, 7000},
+	{GHOST_MODE_CHASE, 20000},
+	{GHOST_MODE_SCATTER, 7000},
+	{GHOST_MODE_CHASE, 20000},
+	{GHOST_MODE_SCATTER, 5000},
+	{GHOST_MODE_CHASE, 20000},
+	{GHOST_MODE_SCATTER, 5000},
+	{GHOST_MODE_CHASE, 0}
+};
+
+// Current (scheduled) ghost mode, index into the schedule and the game time
+// that phase started
+static uint8_t ghost_mode;
+static uint8_t ghost_mode_phase;
+static uint32_t ghost_mode_phase_start;
+
+// Game time the ghosts first became frightened - the schedule is pushed back
+// by the time spent frightened
+static uint32_t frightened_start_time;
+
+// Bit masks (bit n is for ghost n). A ghost is frightened if it hasn't been
+// eaten since the last power pellet. Ghosts are forced to turn around on a
+// mode change.
+static uint8_t ghost_frightened;
+static uint8_t ghost_reverse;
+
+// GHOSTS_NORMAL or GHOSTS_HARD (see game.h)
+static uint8_t ghost_difficulty;
+#define ALL_GHOSTS_MASK ((1 << NUM_GHOSTS) - 1)
 
 //Initial lives of pacman (player)
 #define MAX_LIVES 3
 
-// Initial pacman location and direction
-#define INIT_PACMAN_X 15
-#define INIT_PACMAN_Y 23
+// Initial pacman and ghost directions. (Initial locations and the ghost 
+// home location come from the level definition.)
 #define INIT_PACMAN_DIRN DIRN_RIGHT
-
-// Location of the ghost's home - ghosts will be every 2 cells
-// starting from the left most position (12,15) to (18,15)
-#define GHOST_HOME_Y 15
-#define GHOST_HOME_X_LEFT 12
-#define GHOST_HOME_X_RIGHT 18
-#define GHOST_HOME_ENTRY_Y 14
-#define GHOST_HOME_ENTRY_X_LEFT 14
-#define GHOST_HOME_ENTRY_X_RIGHT 16
 #define INIT_GHOST_DIRN DIRN_RIGHT
 
 // Values to represent the contents of a cell (x,y)
@@ -128,17 +172,6 @@ uint16_t ghost_eat = 0 ;
 #define CELL_CONTAINS_PELLET (-7)
 #define CELL_EMPTY (-5)
 
-// Terminal colours to be used
-static uint8_t ghost_colours[NUM_GHOSTS] = {
-	BG_RED, BG_GREEN, BG_CYAN, BG_MAGENTA
-};
-#define PACMAN_COLOUR (FG_YELLOW)
-
-// Unicode characters used to represent the pacman in each direction
-static const char* pacman_characters[NUM_DIRECTION_VALUES] = {
-	"\u15E4", "\u15E2", "\u15E7", "\u15E3"
-};
-
 // Location of pacman (values will be in the range 0 to FIELD_WIDTH - 1 or FIELD_HEIGHT - 1)
 static uint8_t pacman_x;
 static uint8_t pacman_y;
@@ -151,14 +184,77 @@ static uint8_t ghost_x[NUM_GHOSTS];
 static uint8_t ghost_y[NUM_GHOSTS];
 static uint8_t ghost_direction[NUM_GHOSTS];
 
+// Planned next move of each ghost. ghost_plan[n] is the result of 
+// determine_ghost_direction_to_move() for ghost n (and ghost_plan_options[n]
+// the junction options if that was GHOST_RANDOM_EXIT). The plan is only 
+// valid if bit n of ghost_plans_valid is set - bits are cleared whenever
+// something the decision depends on changes.
+#define GHOST_RANDOM_EXIT 4
+static int8_t ghost_plan[NUM_GHOSTS];
+static int8_t ghost_plan_options[NUM_GHOSTS];
+static uint8_t ghost_plans_valid;
+// What a hard ghost's plan depends on (see ghost_search_direction()): the
+// ghosts whose every move makes it out of date, and how many moves the
+// others can make before it is. Other plans don't depend on where the
+// other ghosts are (GHOST_MOVES_UNLIMITED).
+static uint8_t ghost_plan_reads[NUM_GHOSTS];
+static uint8_t ghost_plan_free_moves[NUM_GHOSTS];
+// Next ghost plan_ghost_moves() will look at - so that planning resumes
+// where it left off
+static uint8_t next_ghost_to_plan;
+// Count of ghost moves where the plan was ready (hits) or had to be 
+// worked out when the ghost moved (misses)
+static uint16_t ghost_plan_hits;
+static uint16_t ghost_plan_misses;
+// Longest time (timer 1 counts) a miss has taken to work out
+static uint16_t max_plan_miss_time;
+
 // Indicate whether the game is running or not - 1 indicates yes,
 // 0 indicates game over
 static uint8_t game_running;
 
+// Queue of game events (see get_game_event()) waiting to be taken. If 
+// redraw_needed is set then the queued events don't matter - everything
+// has to be redrawn.
+#define GAME_EVENT_QUEUE_SIZE 24
+static GameEvent event_queue[GAME_EVENT_QUEUE_SIZE];
+static uint8_t event_queue_start;
+static uint8_t event_queue_length;
+static uint8_t redraw_needed;
+
 ///////////////////////////////////////////////////////////
 // Private Functions
 //
 
+// queue_event() adds an event to the queue. If the queue is full (e.g. 
+// because nothing is drawing the game) everything will have to be redrawn
+// instead.
+static void queue_event(uint8_t type, uint8_t x, uint8_t y, uint8_t ghostnum) {
+	if(redraw_needed) {
+		return;
+	}
+	if(event_queue_length == GAME_EVENT_QUEUE_SIZE) {
+		redraw_needed = 1;
+		return;
+	}
+	GameEvent* event = &event_queue[(event_queue_start + event_queue_length++) % GAME_EVENT_QUEUE_SIZE];
+	event->type = type;
+	event->x = x;
+	event->y = y;
+	event->ghostnum = ghostnum;
+}
+
+// queue_cell_changed() queues an event for a change to what is shown at (x,y)
+static void queue_cell_changed(uint8_t x, uint8_t y) {
+	queue_event(GAME_EVENT_CELL_CHANGED, x, y, 0);
+}
+
+// queue_redraw() throws away any queued events - everything will be redrawn
+static void queue_redraw(void) {
+	event_queue_length = 0;
+	redraw_needed = 1;
+}
+
 uint8_t get_lives (void){
 	return lives; 
 }
@@ -182,11 +278,42 @@ void reset_lives(void){
 
 // is_wall_at() returns true (1) if there is a wall at the given 
 // game location, 0 otherwise
-static int8_t is_wall_at (uint8_t x, uint8_t y) {
+int8_t is_wall_at (uint8_t x, uint8_t y) {
 	// Get information about any wall in that position
-	char wall_character = pgm_read_byte(& init_game_field[y * FIELD_WIDTH + x]);
-	return (wall_character != ' ' && wall_character != '.'
-			&& wall_character != 'P');
+	return bitboard_test(walls[y], x);
+}
+
+// cell_index() returns the walkable cell index of (x,y). Walkable cells are
+// numbered from 0 in row order - the index of the first one in each row is
+// stored with the maze and the rest of the row is counted from the walls 
+// bitboard. (x,y) must not be a wall.
+static uint16_t cell_index(uint8_t x, uint8_t y) {
+	return pgm_read_word(&game_field_cells[y]) + x - bitboard_count_below(walls[y], x);
+}
+
+// edible_cell_at() returns the walkable cell index of (x,y) if there is a 
+// pac-dot or power pellet at that location, NOTHING_EDIBLE otherwise
+#define NOTHING_EDIBLE 0xFFFF
+static uint16_t edible_cell_at(uint8_t x, uint8_t y) {
+	if(is_wall_at(x, y)) {
+		return NOTHING_EDIBLE;
+	}
+	uint16_t cell = cell_index(x, y);
+	if(edibles[cell / 8] & (1 << (cell % 8))) {
+		return cell;
+	} else {
+		return NOTHING_EDIBLE;
+	}
+}
+
+// Returns 1 if the given walkable cell is where a power pellet started
+static int8_t is_pellet_cell(uint16_t cell) {
+	for(uint8_t i = 0; i < num_pellets; i++) {
+		if(pellet_cells[i] == cell) {
+			return 1;
+		}
+	}
+	return 0;
 }
 
 // is_pacman_at() returns true(1) if the pacman is at the given 
@@ -195,37 +322,24 @@ static int8_t is_pacman_at(uint8_t x, uint8_t y) {
 	return (x == pacman_x && y == pacman_y);
 }
 
-// is_pacdot_at() returns true (1) if there is a pacdot at the given
-// game location, 0 otherwise
-static int8_t is_pacdot_at (uint8_t x, uint8_t y) {
-	// Get the details for the row
-	uint32_t dots_on_row = pacdots[y];
-	// Extract the value for the column x (which is in bit x)
-	if(dots_on_row & (1UL<< x)) {
-		return 1;
-	} else {
-		return 0;
-	}
+int8_t is_pacdot_at (uint8_t x, uint8_t y) {
+	uint16_t cell = edible_cell_at(x, y);
+	return (cell != NOTHING_EDIBLE && !is_pellet_cell(cell));
 }
 
-static int8_t is_pellet_at (uint8_t x, uint8_t y) {
-	// Get the details for the row
-	uint32_t dots_on_row = pellets[y];
-	// Extract the value for the column x (which is in bit x)
-	if(dots_on_row & (1UL<< x)) {
-		return 1;
-		} else {
-		return 0;
-	}
+int8_t is_pellet_at (uint8_t x, uint8_t y) {
+	uint16_t cell = edible_cell_at(x, y);
+	return (cell != NOTHING_EDIBLE && is_pellet_cell(cell));
 }
 
 // Returns true (1) if the given location is the home of the ghosts
 // (this includes the entry to the home of the ghosts)
-static int8_t is_ghost_home(uint8_t x, uint8_t y) {
-	if(y == GHOST_HOME_Y && x >= GHOST_HOME_X_LEFT && x <= GHOST_HOME_X_RIGHT) {
+int8_t is_ghost_home(uint8_t x, uint8_t y) {
+	if(y == LEVEL_DATA(ghost_home_y) && x >= LEVEL_DATA(ghost_home_x_left)
+			&& x <= LEVEL_DATA(ghost_home_x_right)) {
 		return 1;
-	} else if(y == GHOST_HOME_ENTRY_Y && x >= GHOST_HOME_ENTRY_X_LEFT
-			&& x <= GHOST_HOME_ENTRY_X_RIGHT) {
+	} else if(y == LEVEL_DATA(ghost_home_entry_y) && x >= LEVEL_DATA(ghost_home_entry_x_left)
+			&& x <= LEVEL_DATA(ghost_home_entry_x_right)) {
 		return 1;
 	} else {
 		return 0;
@@ -233,56 +347,40 @@ static int8_t is_ghost_home(uint8_t x, uint8_t y) {
 }
 
 // The pac-man has just arrived in a location occupied by a pac-dot. Update
-// our array which keeps track of remaining pacdots. Update and output the
-// count of remaining pac-dots.
+// our array which keeps track of remaining pacdots and the count of 
+// remaining pac-dots.
 // See initialise_pacdots() below for information on how the pacdots array
 // is initialised.
 static void eat_pacdot(void) {
-	uint32_t maskval = 1UL << pacman_x; 
-	pacdots[pacman_y] &= ~(maskval); 
+	uint16_t cell = cell_index(pacman_x, pacman_y);
+	edibles[cell / 8] &= ~(1 << (cell % 8));
 	num_pacdots--;
 	add_to_score(10);
-	
-	move_cursor (37, 8); 
-	printf("%13s", "Score: \n"); 
-	move_cursor(37,9); 
-	printf("%11lu\n", get_score());
-
 	if (get_score() > get_highscore()) {
 		set_highscore(get_score()) ; 
 	}
-	
-	move_cursor(37, 10) ;
-	printf("%s", "High Score:\n");
-	
-	move_cursor(37,11); 
-	printf("%11lu\n", get_highscore() );
-	
-	move_cursor(37, 13);
-	printf(("Pacdots Remaining: %11d"), num_pacdots);
-	
-	move_cursor(37, 5 );
-	printf(("Lives: %5d"), get_lives());
-	
+	queue_event(GAME_EVENT_PACDOT_EATEN, pacman_x, pacman_y, 0);
+	if(num_pacdots == 0) {
+		queue_event(GAME_EVENT_LEVEL_COMPLETE, 0, 0, 0);
+	}
 }
 static void eat_pellet(void){
-	uint32_t maskval = 1UL << pacman_x;
-	pellets[pacman_y] &= ~(maskval);
+	uint16_t cell = cell_index(pacman_x, pacman_y);
+	edibles[cell / 8] &= ~(1 << (cell % 8));
 	add_to_score(50);
-	move_cursor (37, 8);
-	printf("%13s", "Score: \n");
-	move_cursor(37,9);
-	printf("%11lu\n", get_score());
 	if (get_score() > get_highscore()) {
 		set_highscore(get_score()) ;
 	}
-	move_cursor(37, 10) ;
-	printf("%s", "High Score:\n");
-	move_cursor(37,11);
-	printf("%11lu\n", get_highscore() );
+	queue_event(GAME_EVENT_PELLET_EATEN, pacman_x, pacman_y, 0);
+	if(!powerup) {
+		frightened_start_time = game_time;
+	}
 	powerup = 1; 
 	ghost_eat =1; 
-	powerup_time_start = get_current_time(); 
+	powerup_time_start = game_time; 
+	// All ghosts (including any already eaten) become frightened and turn around
+	ghost_frightened = ALL_GHOSTS_MASK;
+	ghost_reverse = ALL_GHOSTS_MASK;
 }
 
 
@@ -314,50 +412,88 @@ static int8_t what_is_at(uint8_t x, uint8_t y) {
 	return CELL_EMPTY;
 }
 
-// what_is_in_dirn(x,y,direction) returns what is in the cell one from 
-// the cell at (x,y) in the given direction - provided that is not off
-// the game field. (If it is, we just indicate that a wall is there.)
-// We check for a wall first because this also checks that we're not at the edge
-static int8_t what_is_in_dirn(uint8_t x, uint8_t y, uint8_t direction) {
-	// delta_x and delta_y keep track of the change to the current x,y
-	// - we set these based on the direction we're checking in. One of these
-	// will end up as -1 or +1, the other will stay at 0.
-	int8_t delta_x = 0;
-	int8_t delta_y = 0;
+// Returns true (1) if row y is a tunnel in the current level, i.e. leaving
+// one side of the field on this row brings you back in on the other side
+static int8_t is_tunnel_row(uint8_t y) {
+	for(uint8_t i = 0; i < MAX_TUNNELS; i++) {
+		if(LEVEL_DATA(tunnel_rows[i]) == y) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Returns 1 if (x,y) is inside one of the tunnels, 0 otherwise
+static int8_t is_in_tunnel(uint8_t x, uint8_t y) {
+	uint8_t length = LEVEL_DATA(tunnel_length);
+	return is_tunnel_row(y) && (x < length || x >= FIELD_WIDTH - length);
+}
+
+// advance_progress(&progress, speed) adds one millisecond's worth of 
+// movement at the given speed. Returns 1 if this takes it on to the next 
+// cell (i.e. the progress wraps around), 0 otherwise.
+static uint8_t advance_progress(uint16_t* progress, uint16_t speed) {
+	uint16_t previous = *progress;
+	*progress += speed;
+	return (*progress < previous);
+}
+
+// cell_in_dirn(x,y,direction,&new_x,&new_y) works out the location of the
+// cell one from the cell at (x,y) in the given direction. Moving off the
+// left or right edge of a tunnel row wraps around to the other side. 
+// Returns 1 and sets *new_x and *new_y if this is on the game field, 
+// otherwise returns 0.
+int8_t cell_in_dirn(uint8_t x, uint8_t y, uint8_t direction,
+		uint8_t* new_x, uint8_t* new_y) {
 	switch(direction) {
 		case DIRN_LEFT:
-			if(x == 0) {
-				// We can't move left since we're at the edge
-				return CELL_IS_WALL;
+			if(x > 0) {
+				x--;
+			} else if(is_tunnel_row(y)) {
+				// We're at the edge - carry on through the tunnel
+				x = FIELD_WIDTH-1;
+			} else {
+				return 0;
 			}
-			delta_x = -1;
 			break;
 		case DIRN_RIGHT:
-			if(x == FIELD_WIDTH-1) {
-				// We can't move right since we're at the edge
-				return CELL_IS_WALL;
+			if(x < FIELD_WIDTH-1) {
+				x++;
+			} else if(is_tunnel_row(y)) {
+				x = 0;
+			} else {
+				return 0;
 			}
-			delta_x = 1;
 			break;
 		case DIRN_UP:
 			if(y == 0) {
-				// We can't move up since we're at the edge
-				return CELL_IS_WALL;
+				return 0;
 			}
-			delta_y = -1;
+			y--;
 			break;
 		case DIRN_DOWN:
 			if(y == FIELD_HEIGHT-1) {
-				// We can't move down since we're at the edge
-				return CELL_IS_WALL;
+				return 0;
 			}
-			delta_y = 1;
+			y++;
 			break;
-		default:	// Shouldn't happen - we just return CELL_IS_WALL if
-			// the direction given is invalid
-			return CELL_IS_WALL;
-	}	
-	return what_is_at(x + delta_x, y + delta_y);
+		default:	// Shouldn't happen
+			return 0;
+	}
+	*new_x = x;
+	*new_y = y;
+	return 1;
+}
+
+// what_is_in_dirn(x,y,direction) returns what is in the cell one from 
+// the cell at (x,y) in the given direction - provided that is not off
+// the game field. (If it is, we just indicate that a wall is there.)
+static int8_t what_is_in_dirn(uint8_t x, uint8_t y, uint8_t direction) {
+	uint8_t new_x, new_y;
+	if(!cell_in_dirn(x, y, direction, &new_x, &new_y)) {
+		return CELL_IS_WALL;
+	}
+	return what_is_at(new_x, new_y);
 }
 
 // determine_dirns_ghost_can_move_in()
@@ -393,81 +529,110 @@ static int8_t determine_dirns_ghost_can_move_in(uint8_t x, uint8_t y) {
 	return return_value;
 }
 
-// direction_to_pacman() is called for a ghost position and we return a direction
-// to move in that will take us closer to the pacman (from DIRN_LEFT to DIRN_DOWN)
-// or -1 if we can't move at all. (Note we can only move into cells that are empty
-// OR contain a pacdot OR contain the pacman. We can't move into walls or cells 
-// that contain ghosts.)
-static int8_t direction_to_pacman(uint8_t x, uint8_t y) {
-	int8_t delta_x = pacman_x - x;
-	int8_t delta_y = pacman_y - y;
-	// Work out which direction options are possible
-	int8_t dirn_options = determine_dirns_ghost_can_move_in(x, y);
-	if(dirn_options == 0) {
-		// Can't move
-		return -1;
-	}
-	
-	if(abs(delta_x) < abs(delta_y)) {
-		// Pacman is further away in y direction - try this direction (up/down) first
-		if(delta_y < 0) {
-			if(dirn_options & (1 << DIRN_UP)) {
-				return DIRN_UP;
-			}
-			// Can't move up - move on to checking left/right
-		} else if(delta_y > 0) {
-			if(dirn_options & (1 << DIRN_DOWN)) {
-				return DIRN_DOWN;
-			}
-			// Can't move down - move on to checking left/right
-		} // else delta_y is 0 - so try left/right
-	}
-	// Try the x direction 
-	if(delta_x < 0) {
-		if(dirn_options & (1 << DIRN_LEFT)) {
-			return DIRN_LEFT;
-		}
-		// Pacman is left but we can't move left - try up or down
-		if(delta_y < 0) {
-			if(dirn_options & (1 << DIRN_UP)) {
-				return DIRN_UP;
-			}
-		} else if(dirn_options & (1 << DIRN_DOWN)) {
-			return DIRN_DOWN;
-		}
+// Change in x and y for a move in each direction (indexed by direction value)
+static const int8_t dirn_delta_x[NUM_DIRECTION_VALUES] PROGMEM = { -1, 0, 1, 0 };
+static const int8_t dirn_delta_y[NUM_DIRECTION_VALUES] PROGMEM = { 0, -1, 0, 1 };
+
+// Scatter mode target tile for each ghost - each ghost heads for a different
+// corner. These are deliberately just off the field so the ghost circles 
+// the block nearest the corner.
+//
+// Target tiles can lie outside the field so they need signed coordinates.
+// For the standard size field (and anything up to 40x40) 8 bits are enough 
+// and the square of any distance fits in 16 bits. Larger fields need more.
+#if FIELD_WIDTH <= 40 && FIELD_HEIGHT <= 40
+typedef int8_t TargetCoord;
+typedef uint16_t TargetDistance;
+#define TARGET_DISTANCE_MAX UINT16_MAX
+#else
+typedef int16_t TargetCoord;
+typedef uint32_t TargetDistance;
+#define TARGET_DISTANCE_MAX UINT32_MAX
+#endif
+
+static const TargetCoord ghost_scatter_x[NUM_GHOSTS] PROGMEM = { 
+	FIELD_WIDTH - 3, 2, FIELD_WIDTH - 1, 0
+};
+static const TargetCoord ghost_scatter_y[NUM_GHOSTS] PROGMEM = { 
+	-3, -3, FIELD_HEIGHT + 1, FIELD_HEIGHT + 1
+};
+#if FIELD_WIDTH <= 40 && FIELD_HEIGHT <= 40
+#define SCATTER_TARGET(table, ghostnum) ((TargetCoord)pgm_read_byte(&table[ghostnum]))
+#else
+#define SCATTER_TARGET(table, ghostnum) ((TargetCoord)pgm_read_word(&table[ghostnum]))
+#endif
+
+// Square of the distance between two cells
+static TargetDistance distance_squared(TargetCoord x1, TargetCoord y1, TargetCoord x2, TargetCoord y2) {
+	int16_t dx = x1 - x2;
+	int16_t dy = y1 - y2;
+	return (TargetDistance)dx*dx + (TargetDistance)dy*dy;
+}
+
+// Chase mode target functions. Each works out the target tile (*target_x,
+// *target_y) for the given ghost. Targets may lie outside the game field.
+//
+// Ghost 0 chases the pac-man directly
+static void target_pacman(uint8_t ghostnum, TargetCoord* target_x, TargetCoord* target_y) {
+	*target_x = pacman_x;
+	*target_y = pacman_y;
+}
+
+// Ghost 1 tries to ambush - it targets 4 cells ahead of the pac-man
+static void target_ahead_of_pacman(uint8_t ghostnum, TargetCoord* target_x, TargetCoord* target_y) {
+	*target_x = pacman_x + 4 * (int8_t)pgm_read_byte(&dirn_delta_x[pacman_direction]);
+	*target_y = pacman_y + 4 * (int8_t)pgm_read_byte(&dirn_delta_y[pacman_direction]);
+}
+
+// Ghost 2 works with ghost 0 - it targets the cell found by doubling the
+// vector from ghost 0 to the cell 2 ahead of the pac-man
+static void target_flank_pacman(uint8_t ghostnum, TargetCoord* target_x, TargetCoord* target_y) {
+	TargetCoord ahead_x = pacman_x + 2 * (int8_t)pgm_read_byte(&dirn_delta_x[pacman_direction]);
+	TargetCoord ahead_y = pacman_y + 2 * (int8_t)pgm_read_byte(&dirn_delta_y[pacman_direction]);
+	*target_x = 2 * ahead_x - ghost_x[0];
+	*target_y = 2 * ahead_y - ghost_y[0];
+}
+
+// Ghost 3 chases the pac-man until it gets within 8 cells, then heads back
+// to its scatter corner
+static void target_shy_of_pacman(uint8_t ghostnum, TargetCoord* target_x, TargetCoord* target_y) {
+	if(distance_squared(ghost_x[ghostnum], ghost_y[ghostnum], pacman_x, pacman_y) > 64) {
+		*target_x = pacman_x;
+		*target_y = pacman_y;
 	} else {
-		if(dirn_options & (1 << DIRN_RIGHT)) {
-			return DIRN_RIGHT;
-		}
-		// Pacman is right (or directly above/below) but we can't move right - try up or down
-		if(delta_y < 0) {
-			if(dirn_options & (1 << DIRN_UP)) {
-				return DIRN_UP;
-			} 
-		} else if(dirn_options & (1 << DIRN_DOWN)) {
-			return DIRN_DOWN;
-		}
+		*target_x = SCATTER_TARGET(ghost_scatter_x, ghostnum);
+		*target_y = SCATTER_TARGET(ghost_scatter_y, ghostnum);
 	}
-	// Just move whichever way we can - try until we find one that works
-	for(int8_t dirn = DIRN_LEFT; dirn <= DIRN_DOWN; dirn++) {
-		if(dirn_options & (1 << dirn)) {
-			return dirn;
-		}
-	}
-	// We can't move in any direction
-	return -1;
 }
 
+typedef void (*GhostTargetFunction)(uint8_t ghostnum, TargetCoord* target_x, TargetCoord* target_y);
+
+static const GhostTargetFunction ghost_chase_targets[NUM_GHOSTS] PROGMEM = {
+	target_pacman, target_ahead_of_pacman, target_flank_pacman, target_shy_of_pacman
+};
+
 // determine_ghost_direction_to_move()
 // 
 // Determine the direction the given ghost (0 to 3) should move in.
-// (Each ghost uses a different approach to moving.)
+// Ghosts never turn back on themselves unless forced to (a mode change or
+// a dead end) so corridors and corners need no decision at all. At a 
+// junction the ghost takes the exit that leaves it closest (straight line
+// distance) to its target tile. Ties are broken in favour of up, left, down,
+// then right. Frightened ghosts pick a random exit at each junction instead -
+// we return GHOST_RANDOM_EXIT and the possible exits in *junction_options
+// and the exit is picked when the ghost actually moves.
 // Return -1 if the ghost can't move (e.g. surrounded by walls and other
 // ghosts).
-static int8_t determine_ghost_direction_to_move(uint8_t ghostnum) {
+// This function does not change any game state so it can be called ahead
+// of time (see plan_ghost_moves()). It only records what the decision 
+// depended on in ghost_plan_reads[] and ghost_plan_free_moves[].
+static int8_t determine_ghost_direction_to_move(uint8_t ghostnum, int8_t* junction_options) {
 	uint8_t x = ghost_x[ghostnum];
 	uint8_t y = ghost_y[ghostnum];
 	uint8_t curdirn = ghost_direction[ghostnum];
+	uint8_t reverse_dirn = (curdirn + 2) % 4;
+	ghost_plan_reads[ghostnum] = 0;
+	ghost_plan_free_moves[ghostnum] = GHOST_MOVES_UNLIMITED;
 
 	int8_t dirn_options = determine_dirns_ghost_can_move_in(x,y);
 	if(dirn_options == 0) {
@@ -475,6 +640,13 @@ static int8_t determine_ghost_direction_to_move(uint8_t ghostnum) {
 		return -1;
 	}
 	
+	if(ghost_reverse & (1 << ghostnum)) {
+		// Mode has changed - turn around if we can
+		if(dirn_options & (1 << reverse_dirn)) {
+			return reverse_dirn;
+		}
+	}
+	
 	if(is_ghost_home(x,y)) {
 		// Attempt to move ghost out of home - try UP
 		if(dirn_options & (1 << DIRN_UP)) {
@@ -482,192 +654,260 @@ static int8_t determine_ghost_direction_to_move(uint8_t ghostnum) {
 		}
 		// If this doesn't work, we'll try the usual algorithm
 	}
-	switch(ghostnum) {
-		case 0:
-			// Ghost 0 will always try to move towards the pacman
-			return direction_to_pacman(x, y);
-			break;
-		case 1:
-		case 3:
-			// Ghosts 1 and 3 will always try to keep moving in their current
-			// direction if possible
-			if(dirn_options & (1<<curdirn)) {
-				// Current direction is valid - just keep going
-				return curdirn;
-			} else {
-				// Can't move in current direction - try right angles
-				int8_t new_dirn = (curdirn + ghostnum)%4;
-				if(dirn_options & (1 << new_dirn)) {
-					return new_dirn;
-				} else {
-					// Try the other direction at right angles
-					new_dirn = (new_dirn + 2)%4;
-					if(dirn_options & (1 << new_dirn)) {
-						return new_dirn;
-					} else {
-						// Neither of the right angles directions worked
-						// - just go back in the opposite direction 
-						return (curdirn + 2)%4;
-					}
-				}
+	
+	// Remove the option of turning back. If that leaves nothing we're in a dead
+	// end (or blocked by another ghost) so we have to turn back.
+	int8_t forward_options = dirn_options & ~(1 << reverse_dirn);
+	if(forward_options == 0) {
+		return reverse_dirn;
+	}
+	if((forward_options & (forward_options - 1)) == 0) {
+		// Only one bit set - we're in a corridor or on a corner, just follow it
+		for(int8_t dirn = DIRN_LEFT; dirn <= DIRN_DOWN; dirn++) {
+			if(forward_options == (1 << dirn)) {
+				return dirn;
 			}
-			break;	
-		case 2:
-			// Ghost 2 will try to move in the same direction as the pacman is moving
-			if(dirn_options & (1 << pacman_direction)) {
-				// That direction is one of the valid options
-				return pacman_direction;
-			} else {
-				// Otherwise, start from a random direction and try each in turn
-				int8_t first_direction_to_check = random()%4;
-				for(int8_t i = 0; i < 4; i++) {
-					int8_t direction_to_check = (first_direction_to_check + i)%4;
-					if(dirn_options & (1 << direction_to_check)) {
-						return direction_to_check;
-					
-					}
-				}
-				// Should never get here because one of the directions should be valid
-				// - just indicate that we can't move
-				return -1;
+		}
+	}
+	
+	// We're at a junction
+	if(ghost_frightened & (1 << ghostnum)) {
+		*junction_options = forward_options;
+		return GHOST_RANDOM_EXIT;
+	}
+	
+	TargetCoord target_x, target_y;
+	if(ghost_mode == GHOST_MODE_SCATTER) {
+		target_x = SCATTER_TARGET(ghost_scatter_x, ghostnum);
+		target_y = SCATTER_TARGET(ghost_scatter_y, ghostnum);
+	} else {
+		GhostTargetFunction target_function = 
+				(GhostTargetFunction)pgm_read_word(&ghost_chase_targets[ghostnum]);
+		target_function(ghostnum, &target_x, &target_y);
+	}
+	
+	// Try each exit in tie-break order (up, left, down, right) and keep the
+	// one that ends closest to the target
+	static const uint8_t junction_dirn_order[NUM_DIRECTION_VALUES] PROGMEM = {
+		DIRN_UP, DIRN_LEFT, DIRN_DOWN, DIRN_RIGHT
+	};
+	int8_t best_dirn = -1;
+	TargetDistance best_distance = TARGET_DISTANCE_MAX;
+	for(uint8_t i = 0; i < NUM_DIRECTION_VALUES; i++) {
+		uint8_t dirn = pgm_read_byte(&junction_dirn_order[i]);
+		if(forward_options & (1 << dirn)) {
+			TargetDistance distance = distance_squared(
+					x + (int8_t)pgm_read_byte(&dirn_delta_x[dirn]),
+					y + (int8_t)pgm_read_byte(&dirn_delta_y[dirn]),
+					target_x, target_y);
+			if(distance < best_distance) {
+				best_distance = distance;
+				best_dirn = dirn;
 			}
+		}
 	}
-	// Should never get here either - just indicate that we can't move
-	return -1;	
+	
+	// Hard ghosts look ahead (with the other ghosts) when chasing, and
+	// only go somewhere else if it leaves the pac-man fewer ways out
+	if(ghost_difficulty == GHOSTS_HARD && ghost_mode == GHOST_MODE_CHASE) {
+		best_dirn = ghost_search_direction(ghostnum, forward_options, best_dirn,
+				&ghost_plan_reads[ghostnum], &ghost_plan_free_moves[ghostnum]);
+	}
+	return best_dirn;
 }
 
 
-// draw_initial_game_field()
-static void draw_initial_game_field(void) {
-	clear_terminal();
-	normal_display_mode();
-	hide_cursor();
-	move_cursor(1,1);	// Start at top left
-	uint16_t wall_array_index = 0;  // row_number * 31 + column_number, i.e. 31*x+y
-	for(uint8_t y = 0; y < FIELD_HEIGHT; y++) {
-		for(uint8_t x = 0; x < FIELD_WIDTH; x++) {
-			char wall_character = pgm_read_byte(&init_game_field[wall_array_index]);
-			switch(wall_character) {
-				case '-':	printf("%s", LINE_HORIZONTAL); break;
-				case '|':	printf("%s", LINE_VERTICAL); break;
-				case 'F':	printf("%s", LINE_DOWN_AND_RIGHT); break;
-				case '7':	printf("%s", LINE_DOWN_AND_LEFT); break;
-				case 'L':	printf("%s", LINE_UP_AND_RIGHT); break;
-				case 'J':	printf("%s", LINE_UP_AND_LEFT); break;
-				case '>':	printf("%s", LINE_VERTICAL_AND_RIGHT); break;
-				case '<':	printf("%s", LINE_VERTICAL_AND_LEFT); break;
-				case '^':	printf("%s", LINE_HORIZONTAL_AND_UP); break;
-				case 'v':	printf("%s", LINE_HORIZONTAL_AND_DOWN); break;
-				case '+':	printf("%s", LINE_VERTICAL_AND_HORIZONTAL); break;
-				case ' ':	printf(" "); break;
-				case 'P':	printf("P"); break;	// power-pellet initially just implemented as a pac-dot
-				case '.':	printf("."); break;	// pac-dot
-				default:	printf("x"); break;	// shouldn't happen but we show an x in case it does
-			}
-			wall_array_index++;
+// random_exit()
+// Pick one of the directions in options (a bit mask as returned by
+// determine_dirns_ghost_can_move_in()) at random. options must not be 0.
+static int8_t random_exit(int8_t options) {
+	// Start from a random direction and take the first option we find
+	int8_t first_direction_to_check = next_random()%4;
+	for(int8_t i = 0; i < 4; i++) {
+		int8_t direction_to_check = (first_direction_to_check + i)%4;
+		if(options & (1 << direction_to_check)) {
+			return direction_to_check;
+		}
+	}
+	return -1;
+}
+
+// invalidate_ghost_plans_near()
+// A ghost has moved out of or into (x,y). Throw away the planned move of any 
+// ghost that this could block or unblock, i.e. any ghost at or next to (x,y).
+static void invalidate_ghost_plans_near(uint8_t x, uint8_t y) {
+	uint8_t tunnel = is_tunnel_row(y);
+	for(uint8_t i = 0; i < NUM_GHOSTS; i++) {
+		uint8_t distance_x = abs(ghost_x[i] - x);
+		if(tunnel && distance_x == FIELD_WIDTH - 1) {
+			// Cells are next to each other through the tunnel
+			distance_x = 1;
+		}
+		if(distance_x + abs(ghost_y[i] - y) <= 1) {
+			ghost_plans_valid &= ~(1 << i);
 		}
-		printf("\n");
 	}
 }
 
+// initialise_pacdots()
+// Decode the maze for this level into the walls, edibles and pellet_cells 
+// arrays. Walkable cells are met in index order so we just count them.
 static void initialise_pacdots(void) {
+	MazeDecoder decoder;
+	uint16_t start_time = get_timer1_count();
+	uint16_t cell = 0;
 	num_pacdots = 0;
-	uint16_t wall_array_index = 0;  // row_number * 31 + column_number, i.e. 31*x+y
+	num_pellets = 0;
+	for(uint16_t i = 0; i < sizeof(edibles); i++) {
+		edibles[i] = 0;
+	}
+	maze_decoder_start(&decoder, game_field);
 	for(uint8_t y = 0; y < FIELD_HEIGHT; y++) {
-		pacdots[y] = 0;
-		pellets[y] = 0; 
+		bitboard_clear_row(walls[y]);
 		for(uint8_t x = 0; x < FIELD_WIDTH; x++) {
-			char wall_character = pgm_read_byte(&init_game_field[wall_array_index]);
-			if(wall_character == '.' ) {
-				pacdots[y] |= (1UL<<x);
+			uint8_t cell_class = maze_decoder_next(&decoder);
+			if(cell_class >= CELL_CLASS_FIRST_WALL) {
+				bitboard_set(walls[y], x);
+				continue;
+			}
+			if(cell_class == CELL_CLASS_PACDOT) {
+				edibles[cell / 8] |= (1 << (cell % 8));
 				num_pacdots++;
-			}else if (wall_character =='P'){
-				pellets[y] |= (1UL<<x); 
+			} else if(cell_class == CELL_CLASS_PELLET && num_pellets < MAX_PELLETS) {
+				edibles[cell / 8] |= (1 << (cell % 8));
+				pellet_cells[num_pellets++] = cell;
 			}
-			wall_array_index++;
+			cell++;
 		}
-	}	
-}
-
-// Erase the pixel at the given location - presumably because the 
-// ghost or the pac-man has moved out of this space. If there is 
-// still a pac-dot at this space, we output a dot, otherwise we
-// output a space. It is assumed that we are in normal video mode.
-static void erase_pixel_at(uint8_t x, uint8_t y) {
-	move_cursor(x+1, y+1);
-	if(is_pacdot_at(x,y)) {
-		printf(".");
- 	} else if (is_pellet_at(x,y)){
-		printf("P"); 
-	 }
-	 else {
-		printf(" ");
-	 }
-}
-
-// We draw the pac-man at the given location. The character used
-// to draw the pac-man is based on the direction it is currently
-// facing.
-static void draw_pacman_at(uint8_t x, uint8_t y) {
-	move_cursor(x+1,y+1);
-	set_display_attribute(PACMAN_COLOUR);
-	printf("%s", pacman_characters[pacman_direction]);
-	normal_display_mode();
-}
-
-// ghostnum is assumed to be in the range 0..NUM_GHOSTS-1
-// x and y values are assumed to be valid
-static void draw_ghost_at(uint8_t ghostnum, uint8_t x, uint8_t y) {
-	move_cursor(x+1,y+1);
-	// change the background colour to the colour of the given ghost
-	set_display_attribute(ghost_colours[ghostnum]);
-	// If there is a pac-dot at this location we output a "." otherwise
-	// we output a space (which will be shown as a block in reverse video)
-	if(is_pacdot_at(x,y)) {
-		printf(".");
-	} else if (is_pellet_at(x,y)){
-		printf("P"); 
 	}
-	else {
-		printf(" ");
+	maze_decode_time = get_timer1_count() - start_time;
+	maze_encoded_size = decoder.next_byte - game_field;
+}
+
+// update_ghost_mode()
+// Called before anything moves. Ends the power pellet once it has run out
+// and steps through the ghost mode schedule using the game clock.
+static void update_ghost_mode(void) {
+	uint32_t current_time = game_time;
+	if(powerup) {
+		if(current_time - powerup_time_start < SPEED_DATA(frightened_time)) {
+			// Schedule is suspended while the ghosts are frightened
+			return;
+		}
+		powerup = 0;
+		ghost_eat = 0;
+		ghost_plans_valid = 0;
+		ghost_mode_phase_start += current_time - frightened_start_time;
+		// Any ghosts still frightened go back to their usual colours
+		uint8_t was_frightened = ghost_frightened;
+		ghost_frightened = 0;
+		for(uint8_t i = 0; i < NUM_GHOSTS; i++) {
+			if(was_frightened & (1 << i)) {
+				queue_cell_changed(ghost_x[i], ghost_y[i]);
+			}
+		}
+	}
+	uint16_t duration = pgm_read_word(&ghost_mode_schedule[ghost_mode_phase].duration);
+	if(duration != 0 && current_time - ghost_mode_phase_start >= duration) {
+		// Move on to the next phase - all ghosts turn around
+		ghost_mode_phase_start += duration;
+		ghost_mode_phase++;
+		ghost_mode = pgm_read_byte(&ghost_mode_schedule[ghost_mode_phase].mode);
+		ghost_reverse = ALL_GHOSTS_MASK;
+		ghost_plans_valid = 0;
 	}
-	// Return to normal display mode to ensure we don't use this
-	// background colour for any other printing
-	normal_display_mode();
+}
+
+// lose_life()
+// The pac-man has been caught. The game is over (nothing moves any more)
+// once there are no lives left.
+static void lose_life(void) {
+	lives--;
+	if(lives == 0) {
+		game_running = 0;
+	}
+}
+
+// send_ghost_home()
+// Return the given ghost to the left hand end of the ghost home (e.g.
+// because it has been eaten). This is a jump (and a hard ghost's plan can
+// depend on a ghost being frightened) so all the plans are out of date.
+static void send_ghost_home(uint8_t ghostnum) {
+	ghost_x[ghostnum] = LEVEL_DATA(ghost_home_x_left);
+	ghost_y[ghostnum] = LEVEL_DATA(ghost_home_y);
+	ghost_plans_valid = 0;
+	queue_cell_changed(ghost_x[ghostnum], ghost_y[ghostnum]);
+}
+
+// select_level()
+// Look up the maze and speeds for level_number and set up the walls and
+// pac-dots from the maze. Nothing is drawn. The game time restarts from
+// the current time.
+static void select_level(void) {
+	current_level = &level_definitions[level_number % NUM_LEVELS];
+	if(level_number < NUM_SPEED_LEVELS) {
+		current_speeds = &level_speeds[level_number];
+	} else {
+		current_speeds = &level_speeds[NUM_SPEED_LEVELS - 1];
+	}
+	game_field = (const uint8_t*)pgm_read_word(&current_level->field);
+	game_field_cells = (const uint16_t*)pgm_read_word(&current_level->cells);
+	initialise_pacdots();
+	game_time = get_current_time();
 }
 
 /////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////
 // Public Functions
 void initialise_game_level(void) {
-	draw_initial_game_field();
-	initialise_pacdots();
-	pacman_x = INIT_PACMAN_X;
-	pacman_y = INIT_PACMAN_Y;
+	select_level();
+	pacman_x = LEVEL_DATA(pacman_x);
+	pacman_y = LEVEL_DATA(pacman_y);
 	pacman_direction = INIT_PACMAN_DIRN;
-	draw_pacman_at(pacman_x, pacman_y);
+	powerup = 0;
+	ghost_eat = 0;
+	ghost_frightened = 0;
+	ghost_reverse = 0;
+	ghost_plans_valid = 0;
+	ghost_mode_phase = 0;
+	ghost_mode = pgm_read_byte(&ghost_mode_schedule[0].mode);
+	ghost_mode_phase_start = game_time;
+	// (Not used until a power pellet is eaten, but set so that the saved
+	// game state only depends on what has happened in the game)
+	frightened_start_time = game_time;
+	powerup_time_start = game_time;
+	pacman_progress = 0;
 	for(int8_t i = 0; i < NUM_GHOSTS; i++) {
-		ghost_x[i] = GHOST_HOME_X_LEFT + 2*i;
-		ghost_y[i] = GHOST_HOME_Y;
+		ghost_x[i] = LEVEL_DATA(ghost_home_x_left) + 2*i;
+		ghost_y[i] = LEVEL_DATA(ghost_home_y);
 		ghost_direction[i] = INIT_GHOST_DIRN;
-		draw_ghost_at(i, ghost_x[i], ghost_y[i]);
+		ghost_progress[i] = 0;
 	}
+	queue_redraw();
 }
 
 void initialise_game(void) {
+	level_number = 0;
+	game_ticks = 0;
 	initialise_game_level();
 	game_running = 1;
 }
 
+void initialise_next_level(void) {
+	level_number++;
+	initialise_game_level();
+}
+
+uint8_t get_level(void) {
+	return level_number;
+}
+
 int8_t move_pacman(void) {
 	if(!game_running) {
 		// Game is over - do nothing
 		return 0;
 	}
-	// If the pac-man is about to exit through the end of a passage-way
-	// then wrap its location around to the other side of the game field
-	// YOUR CODE HERE - you may need to alter the code below also
-	
+	update_ghost_mode();
 	// Work out what is in the direction we want to move
 	int8_t cell_contents = what_is_in_dirn(pacman_x, pacman_y, pacman_direction);
 	if(cell_contents == CELL_IS_WALL)  {
@@ -675,53 +915,30 @@ int8_t move_pacman(void) {
 		
 		return 0;	// We can't move - wall is straight ahead
 	}
-	// We can move - erase the pac-man in the current location
-	erase_pixel_at(pacman_x, pacman_y);
-	// Update the pac-man location
-	
-	 if (pacman_direction == DIRN_LEFT) {
-		 pacman_x--;
-
-		 if (pacman_x == 0 && pacman_y == 15 ) {
-			 pacman_x = 30 ;
-		 }
-		 
-		 } else if (pacman_direction == DIRN_RIGHT) {
-		 pacman_x++;
-		 if (pacman_x == 30 && pacman_y == 15 ) {
-			 pacman_x = 0 ;
-		 }
-	 }
-		else if(pacman_direction == DIRN_UP) {
-		 pacman_y--;
-		 } else {
-		 pacman_y++;
-	 }
-
-	if(cell_contents >= 0 && powerup == 0) {
+	// We can move - the pac-man leaves the current location. All the ghost 
+	// targets depend on where the pac-man is so their plans are out of date.
+	queue_cell_changed(pacman_x, pacman_y);
+	ghost_plans_valid = 0;
+	// Update the pac-man location (this wraps around through tunnels)
+	cell_in_dirn(pacman_x, pacman_y, pacman_direction, &pacman_x, &pacman_y);
+	queue_cell_changed(pacman_x, pacman_y);
+
+	if(cell_contents >= 0 && !(ghost_frightened & (1 << cell_contents))) {
 		
-		// We've encountered a ghost - draw both at the location
-		// Set the background colour to that of the ghost
-		// before we print out the pac-man
+		// We've encountered a ghost - lose a life.
 		// Note that the variable cell_contents contains the ghost number
-		set_display_attribute(ghost_colours[cell_contents]);
-		draw_pacman_at(pacman_x, pacman_y);
-		lives--; 
-		move_cursor(37, 5 );
-		printf(("Lives: %5d"), get_lives());
+		lose_life(); 
+		queue_event(GAME_EVENT_LIFE_LOST, pacman_x, pacman_y, cell_contents);
 		//Reset Ghost back to home.
-		ghost_x[cell_contents] = GHOST_HOME_X_LEFT ;
-		ghost_y[cell_contents] = GHOST_HOME_Y ;
-		//Draw ghost back home.
-		draw_ghost_at(cell_contents, GHOST_HOME_X_LEFT, GHOST_HOME_Y);
+		send_ghost_home(cell_contents);
 		
 		
-	} else if(cell_contents >= 0 && powerup == 1){
+	} else if(cell_contents >= 0){
+		// Ghost is frightened - eat it. It is no longer frightened once home.
+		queue_event(GAME_EVENT_GHOST_EATEN, pacman_x, pacman_y, cell_contents);
+		ghost_frightened &= ~(1 << cell_contents);
 		//Reset Ghost back to home.
-		ghost_x[cell_contents] = GHOST_HOME_X_LEFT ;
-		ghost_y[cell_contents] = GHOST_HOME_Y ;
-		//Draw ghost back home.
-		draw_ghost_at(cell_contents, GHOST_HOME_X_LEFT, GHOST_HOME_Y);
+		send_ghost_home(cell_contents);
 		if(ghost_eat==1){
 			add_to_score(200);
 			ghost_eat++ ; 
@@ -734,20 +951,10 @@ int8_t move_pacman(void) {
 		}else if(ghost_eat==4){
 			add_to_score(1600);
 		} 
-		move_cursor (37, 8);
-		printf("%13s", "Score: \n");
-		move_cursor(37,9);
-		printf("%11lu\n", get_score());
-
 		if (get_score() > get_highscore()) {
 			set_highscore(get_score()) ;
 		}
-		
-		move_cursor(37, 10) ;
-		printf("%s", "High Score:\n");
-		
-		move_cursor(37,11);
-		printf("%11lu\n", get_highscore() );
+		queue_event(GAME_EVENT_SCORE_CHANGED, 0, 0, 0);
 	}
 	else {
 		if(cell_contents == CELL_CONTAINS_PACDOT) {
@@ -755,7 +962,6 @@ int8_t move_pacman(void) {
 		} else if (cell_contents == CELL_CONTAINS_PELLET) {
 			eat_pellet(); 
 		}
-		draw_pacman_at(pacman_x, pacman_y);
 	}
 	return 1;
 }
@@ -771,9 +977,13 @@ int8_t change_pacman_direction(int8_t direction) {
 		// Can't move
 		return 0;
 	} else {
+		if(pacman_direction != direction) {
+			// Some ghost targets depend on the pac-man direction and
+			// the pac-man is drawn facing the new direction
+			ghost_plans_valid = 0;
+			queue_cell_changed(pacman_x, pacman_y);
+		}
 		pacman_direction = direction;
-		// Redraw the pacman so it is facing in the right direction
-		draw_pacman_at(pacman_x, pacman_y);
 		return 1;
 	}
 }
@@ -784,59 +994,77 @@ void move_ghost(int8_t ghostnum) {
 		// Game is over - do nothing
 		return;
 	}
-	int8_t dirn_to_move = determine_ghost_direction_to_move(ghostnum);
+	update_ghost_mode();
+	int8_t dirn_to_move;
+	if(ghost_plans_valid & (1 << ghostnum)) {
+		// Move was worked out ahead of time
+		dirn_to_move = ghost_plan[ghostnum];
+		ghost_plan_hits++;
+	} else {
+		// Not planned - this is the time the game is held up by
+		uint16_t start_time = get_timer1_count();
+		dirn_to_move = determine_ghost_direction_to_move(ghostnum, 
+				&ghost_plan_options[ghostnum]);
+		ghost_plan_misses++;
+		if((uint16_t)(get_timer1_count() - start_time) > max_plan_miss_time) {
+			max_plan_miss_time = get_timer1_count() - start_time;
+		}
+	}
+	if(dirn_to_move == GHOST_RANDOM_EXIT) {
+		dirn_to_move = random_exit(ghost_plan_options[ghostnum]);
+	}
 	if(dirn_to_move < 0) {
 		// Ghost can't move (e.g. boxed in) - do nothing
 		return;
 	}
+	ghost_reverse &= ~(1 << ghostnum);
 	
-	// Erase the ghost from the current location
-	erase_pixel_at(ghost_x[ghostnum], ghost_y[ghostnum]);
+	// The ghost leaves the current location - throw away the plans of any
+	// ghosts this could affect. Ghost 2's target depends on where ghost 0 is
+	// and hard ghosts look at where the other ghosts near enough are. A
+	// plan that found this ghost too far away to matter is good for a few
+	// more moves - unless it turns back.
+	queue_cell_changed(ghost_x[ghostnum], ghost_y[ghostnum]);
+	ghost_plans_valid &= ~(1 << ghostnum);
+	invalidate_ghost_plans_near(ghost_x[ghostnum], ghost_y[ghostnum]);
+	if(ghostnum == 0) {
+		ghost_plans_valid &= ~(1 << 2);
+	}
+	uint8_t turning_back = (dirn_to_move == (ghost_direction[ghostnum] + 2) % 4);
+	for(uint8_t i = 0; i < NUM_GHOSTS; i++) {
+		if(ghost_plan_reads[i] & (1 << ghostnum)) {
+			ghost_plans_valid &= ~(1 << i);
+		} else if(ghost_plan_free_moves[i] != GHOST_MOVES_UNLIMITED) {
+			if(turning_back || ghost_plan_free_moves[i] == 0) {
+				ghost_plans_valid &= ~(1 << i);
+			} else {
+				ghost_plan_free_moves[i]--;
+			}
+		}
+	}
 	
 	// Update the ghost's direction (it's possible this may be the same value)
 	ghost_direction[ghostnum] = dirn_to_move;
 	// Update the ghost's location
-	switch(dirn_to_move) {
-		case DIRN_LEFT:
-			ghost_x[ghostnum]--;
-			break;
-		case DIRN_RIGHT:
-			ghost_x[ghostnum]++;
-			break;
-		case DIRN_UP:
-			ghost_y[ghostnum]--;
-			break;
-		case DIRN_DOWN:
-			ghost_y[ghostnum]++;
-			break;
-	}
+	cell_in_dirn(ghost_x[ghostnum], ghost_y[ghostnum], dirn_to_move,
+			&ghost_x[ghostnum], &ghost_y[ghostnum]);
 	
 	// Check if the pac-man is at this ghost location. 
-	if(is_pacman_at(ghost_x[ghostnum], ghost_y[ghostnum]) && powerup == 0) {
+	uint8_t frightened = ghost_frightened & (1 << ghostnum);
+	if(is_pacman_at(ghost_x[ghostnum], ghost_y[ghostnum]) && !frightened) {
 		// Ghost has just moved into the pac-man. Lose 1 life.
-		lives--;
-		move_cursor(37, 5 );
-		printf(("Lives: %5d"), get_lives());
-		
-		// We draw the background colour for the
-		//ghost and output the pac-man over the top of it.
-		set_display_attribute(ghost_colours[ghostnum]);
-		draw_pacman_at(ghost_x[ghostnum], ghost_y[ghostnum]);
-		//Reset Ghost back to home. 
-		ghost_x[ghostnum] = GHOST_HOME_X_LEFT ; 
-		ghost_y[ghostnum] = GHOST_HOME_Y ; 
-		//Draw ghost back home.
-		draw_ghost_at(ghostnum, GHOST_HOME_X_LEFT, GHOST_HOME_Y);
+		lose_life();
+		queue_event(GAME_EVENT_LIFE_LOST, pacman_x, pacman_y, ghostnum);
+		//Reset Ghost back to home.
+		send_ghost_home(ghostnum);
 		
-	} else if(is_pacman_at(ghost_x[ghostnum], ghost_y[ghostnum]) && powerup == 1)
+	} else if(is_pacman_at(ghost_x[ghostnum], ghost_y[ghostnum]) && frightened)
 	{
-		set_display_attribute(ghost_colours[ghostnum]);
-		draw_pacman_at(ghost_x[ghostnum], ghost_y[ghostnum]);
+		// Ghost is eaten - it is no longer frightened once home
+		queue_event(GAME_EVENT_GHOST_EATEN, pacman_x, pacman_y, ghostnum);
+		ghost_frightened &= ~(1 << ghostnum);
 		//Reset Ghost back to home.
-		ghost_x[ghostnum] = GHOST_HOME_X_LEFT ;
-		ghost_y[ghostnum] = GHOST_HOME_Y ;
-		//Draw ghost back home.
-		draw_ghost_at(ghostnum, GHOST_HOME_X_LEFT, GHOST_HOME_Y);
+		send_ghost_home(ghostnum);
 		
 		if(ghost_eat==1){
 			add_to_score(200);
@@ -851,28 +1079,329 @@ void move_ghost(int8_t ghostnum) {
 			add_to_score(1600);
 			
 		}
-		move_cursor (37, 8);
-		printf("%13s", "Score: \n");
-		move_cursor(37,9);
-		printf("%11lu\n", get_score());
-
 		if (get_score() > get_highscore()) {
 			set_highscore(get_score()) ;
 		}
-		
-		move_cursor(37, 10) ;
-		printf("%s", "High Score:\n");
-		
-		move_cursor(37,11);
-		printf("%11lu\n", get_highscore() );
-		
+		queue_event(GAME_EVENT_SCORE_CHANGED, 0, 0, 0);
 	}
 	else {
-		
-		draw_ghost_at(ghostnum, ghost_x[ghostnum], ghost_y[ghostnum]);
-		
+		queue_cell_changed(ghost_x[ghostnum], ghost_y[ghostnum]);
 	}
-	normal_display_mode();
+	invalidate_ghost_plans_near(ghost_x[ghostnum], ghost_y[ghostnum]);
+}
+
+// ghosts_in_play()
+// Returns 1 if the ghosts will move again this level - not once the game is
+// over or the level is complete (when the game waits for a button press), 
+// so there's no point planning their moves.
+static uint8_t ghosts_in_play(void) {
+	return game_running && num_pacdots != 0;
+}
+
+void plan_ghost_moves(uint16_t budget) {
+	if(!ghosts_in_play()) {
+		return;
+	}
+	uint16_t start_time = get_timer1_count();
+	// Visit each ghost at most once, starting where we left off last time.
+	// The budget is only checked between ghosts - most decisions are short
+	// but a hard ghost's search can go over it (see get_ghost_plan_stats()).
+	for(uint8_t i = 0; i < NUM_GHOSTS; i++) {
+		uint8_t ghostnum = next_ghost_to_plan;
+		if(!(ghost_plans_valid & (1 << ghostnum))) {
+			ghost_plan[ghostnum] = determine_ghost_direction_to_move(ghostnum,
+					&ghost_plan_options[ghostnum]);
+			ghost_plans_valid |= (1 << ghostnum);
+		}
+		next_ghost_to_plan = (ghostnum + 1) % NUM_GHOSTS;
+		if((uint16_t)(get_timer1_count() - start_time) >= budget) {
+			return;
+		}
+	}
+}
+
+int8_t ghost_moves_to_plan(void) {
+	return ghosts_in_play() && ghost_plans_valid != (1 << NUM_GHOSTS) - 1;
+}
+
+uint32_t get_game_time(void) {
+	return game_time;
+}
+
+void set_game_time(uint32_t time) {
+	uint32_t shift = time - game_time;
+	game_time = time;
+	ghost_mode_phase_start += shift;
+	frightened_start_time += shift;
+	powerup_time_start += shift;
+}
+
+void advance_game_time(void) {
+	game_time++;
+	game_ticks++;
+	if(advance_progress(&pacman_progress, get_pacman_speed())) {
+		move_pacman();
+	}
+	for(int8_t i = 0; i < NUM_GHOSTS; i++) {
+		if(is_game_over() || is_level_complete()) {
+			return;
+		}
+		if(advance_progress(&ghost_progress[i], get_ghost_speed(i))) {
+			move_ghost(i);
+		}
+	}
+}
+
+uint16_t get_pacman_speed(void) {
+	if(powerup) {
+		return SPEED_DATA(pacman_frightened);
+	}
+	return SPEED_DATA(pacman);
+}
+
+uint16_t get_ghost_speed(int8_t ghostnum) {
+	if(is_in_tunnel(ghost_x[ghostnum], ghost_y[ghostnum])) {
+		return SPEED_DATA(ghost_tunnel);
+	} else if(ghost_frightened & (1 << ghostnum)) {
+		return SPEED_DATA(ghost_frightened);
+	}
+	return SPEED_DATA(ghost[ghostnum]);
+}
+
+// Helpers for packing the game state - multi-byte values are stored least
+// significant byte first
+static uint8_t* pack_word(uint8_t* buffer, uint16_t value) {
+	*buffer++ = value;
+	*buffer++ = value >> 8;
+	return buffer;
+}
+
+static uint8_t* pack_long(uint8_t* buffer, uint32_t value) {
+	buffer = pack_word(buffer, value);
+	return pack_word(buffer, value >> 16);
+}
+
+static uint16_t unpack_word(const uint8_t** buffer) {
+	uint16_t value = (*buffer)[0] | ((*buffer)[1] << 8);
+	*buffer += 2;
+	return value;
+}
+
+static uint32_t unpack_long(const uint8_t** buffer) {
+	uint32_t value = unpack_word(buffer);
+	return value | ((uint32_t)unpack_word(buffer) << 16);
+}
+
+void save_game_state(uint8_t* buffer) {
+	*buffer++ = level_number;
+	*buffer++ = lives;
+	*buffer++ = game_running;
+	buffer = pack_word(buffer, random_state);
+	buffer = pack_long(buffer, game_ticks);
+	buffer = pack_long(buffer, get_score());
+	buffer = pack_word(buffer, num_pacdots);
+	for(uint16_t i = 0; i < sizeof(edibles); i++) {
+		*buffer++ = edibles[i];
+	}
+	*buffer++ = pacman_x;
+	*buffer++ = pacman_y;
+	*buffer++ = pacman_direction;
+	buffer = pack_word(buffer, pacman_progress);
+	for(uint8_t i = 0; i < NUM_GHOSTS; i++) {
+		*buffer++ = ghost_x[i];
+		*buffer++ = ghost_y[i];
+		*buffer++ = ghost_direction[i];
+		buffer = pack_word(buffer, ghost_progress[i]);
+	}
+	*buffer++ = powerup;
+	*buffer++ = ghost_eat;
+	*buffer++ = ghost_mode;
+	*buffer++ = ghost_mode_phase;
+	*buffer++ = ghost_frightened;
+	*buffer++ = ghost_reverse;
+	*buffer++ = ghost_difficulty;
+	// Times are stored relative to the game time
+	buffer = pack_long(buffer, game_time - ghost_mode_phase_start);
+	buffer = pack_long(buffer, game_time - frightened_start_time);
+	pack_long(buffer, game_time - powerup_time_start);
+}
+
+// Offsets in a saved game state (see save_game_state()) of the values
+// checked by is_valid_game_state(). The pac-man and then each ghost take
+// STATE_MOVER_SIZE bytes: x, y, direction and progress (2 bytes).
+#define STATE_LIVES 1
+#define STATE_RUNNING 2
+#define STATE_RANDOM 3
+#define STATE_PACDOTS 13
+#define STATE_EDIBLES 15
+#define STATE_MOVERS (STATE_EDIBLES + sizeof(edibles))
+#define STATE_MOVER_SIZE 5
+#define STATE_MODES (STATE_MOVERS + (NUM_GHOSTS + 1) * STATE_MOVER_SIZE)
+#define NUM_GHOST_MODE_PHASES (sizeof(ghost_mode_schedule) / sizeof(GhostModePhase))
+
+// Returns 1 if the pac-man or a ghost in the saved game state is at (x,y)
+static uint8_t is_mover_in_state_at(const uint8_t* buffer, uint8_t x, uint8_t y) {
+	const uint8_t* mover = &buffer[STATE_MOVERS];
+	for(uint8_t i = 0; i <= NUM_GHOSTS; i++, mover += STATE_MOVER_SIZE) {
+		if(mover[0] == x && mover[1] == y) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int8_t is_valid_game_state(const uint8_t* buffer) {
+	const uint8_t* modes = &buffer[STATE_MODES];
+	const uint8_t* mover = &buffer[STATE_MOVERS];
+	const uint8_t* edible_bits = &buffer[STATE_EDIBLES];
+	MazeDecoder decoder;
+	uint16_t cell = 0;
+	uint16_t pacdots = 0;
+	uint8_t pellets = 0;
+
+	// modes[] is powerup, ghost_eat, ghost_mode, ghost_mode_phase, 
+	// ghost_frightened, ghost_reverse and ghost_difficulty
+	if(buffer[STATE_LIVES] > MAX_LIVES || buffer[STATE_RUNNING] > 1 ||
+			(buffer[STATE_RANDOM] | buffer[STATE_RANDOM + 1]) == 0 ||
+			modes[0] > 1 || modes[1] > 4 || modes[2] > GHOST_MODE_CHASE ||
+			modes[3] >= NUM_GHOST_MODE_PHASES || modes[4] > ALL_GHOSTS_MASK ||
+			modes[5] > ALL_GHOSTS_MASK || modes[6] > GHOSTS_HARD) {
+		return 0;
+	}
+	for(uint8_t i = 0; i <= NUM_GHOSTS; i++, mover += STATE_MOVER_SIZE) {
+		if(mover[0] >= FIELD_WIDTH || mover[1] >= FIELD_HEIGHT ||
+				mover[2] >= NUM_DIRECTION_VALUES) {
+			return 0;
+		}
+	}
+
+	// Go through the level's maze (as initialise_pacdots() does) checking
+	// nothing is in a wall and counting the pac-dots left. Anything left
+	// on a walkable cell that isn't a power pellet is eaten as a pac-dot.
+	maze_decoder_start(&decoder, (const uint8_t*)pgm_read_word(
+			&level_definitions[buffer[0] % NUM_LEVELS].field));
+	for(uint8_t y = 0; y < FIELD_HEIGHT; y++) {
+		for(uint8_t x = 0; x < FIELD_WIDTH; x++) {
+			uint8_t cell_class = maze_decoder_next(&decoder);
+			if(cell_class >= CELL_CLASS_FIRST_WALL) {
+				if(is_mover_in_state_at(buffer, x, y)) {
+					return 0;
+				}
+				continue;
+			}
+			uint8_t is_pellet = (cell_class == CELL_CLASS_PELLET && pellets < MAX_PELLETS);
+			pellets += is_pellet;
+			if((edible_bits[cell / 8] & (1 << (cell % 8))) && !is_pellet) {
+				pacdots++;
+			}
+			cell++;
+		}
+	}
+	// There is nothing past the last walkable cell
+	for(; cell < 8 * sizeof(edibles); cell++) {
+		if(edible_bits[cell / 8] & (1 << (cell % 8))) {
+			return 0;
+		}
+	}
+	return pacdots == (buffer[STATE_PACDOTS] | (buffer[STATE_PACDOTS + 1] << 8));
+}
+
+int8_t restore_game_state(const uint8_t* buffer) {
+	if(!is_valid_game_state(buffer)) {
+		return 0;
+	}
+	level_number = *buffer++;
+	select_level();
+	lives = *buffer++;
+	game_running = *buffer++;
+	set_random_state(unpack_word(&buffer));
+	game_ticks = unpack_long(&buffer);
+	set_score(unpack_long(&buffer));
+	num_pacdots = unpack_word(&buffer);
+	for(uint16_t i = 0; i < sizeof(edibles); i++) {
+		edibles[i] = *buffer++;
+	}
+	pacman_x = *buffer++;
+	pacman_y = *buffer++;
+	pacman_direction = *buffer++;
+	pacman_progress = unpack_word(&buffer);
+	for(uint8_t i = 0; i < NUM_GHOSTS; i++) {
+		ghost_x[i] = *buffer++;
+		ghost_y[i] = *buffer++;
+		ghost_direction[i] = *buffer++;
+		ghost_progress[i] = unpack_word(&buffer);
+	}
+	powerup = *buffer++;
+	ghost_eat = *buffer++;
+	ghost_mode = *buffer++;
+	ghost_mode_phase = *buffer++;
+	ghost_frightened = *buffer++;
+	ghost_reverse = *buffer++;
+	ghost_difficulty = *buffer++;
+	ghost_mode_phase_start = game_time - unpack_long(&buffer);
+	frightened_start_time = game_time - unpack_long(&buffer);
+	powerup_time_start = game_time - unpack_long(&buffer);
+	ghost_plans_valid = 0;
+	
+	queue_redraw();
+	return 1;
+}
+
+uint32_t get_game_ticks(void) {
+	return game_ticks;
+}
+
+void set_random_state(uint16_t state) {
+	if(state == 0) {
+		// 0 is the one state the generator never leaves
+		state = 1;
+	}
+	random_state = state;
+}
+
+uint16_t get_random_state(void) {
+	return random_state;
+}
+
+void set_ghost_difficulty(uint8_t difficulty) {
+	ghost_difficulty = difficulty;
+	ghost_plans_valid = 0;
+}
+
+uint8_t get_ghost_difficulty(void) {
+	return ghost_difficulty;
+}
+
+#if RANDOM_COST_BENCH
+void measure_random_cost(uint16_t* game_random_time, uint16_t* libc_random_time) {
+	// volatile so the compiler can't throw the results away
+	volatile uint16_t result;
+	uint16_t saved_state = random_state;
+	uint16_t start_time = get_timer1_count();
+	for(uint8_t i = 0; i < RANDOM_COST_CALLS; i++) {
+		result = next_random();
+	}
+	*game_random_time = get_timer1_count() - start_time;
+	start_time = get_timer1_count();
+	for(uint8_t i = 0; i < RANDOM_COST_CALLS; i++) {
+		result = random();
+	}
+	*libc_random_time = get_timer1_count() - start_time;
+	(void)result;
+	// Don't disturb the game
+	random_state = saved_state;
+}
+#endif /* RANDOM_COST_BENCH */
+
+void get_maze_stats(uint16_t* encoded_size, uint16_t* decode_time) {
+	*encoded_size = maze_encoded_size;
+	*decode_time = maze_decode_time;
+}
+
+void get_ghost_plan_stats(uint16_t* hits, uint16_t* misses, uint16_t* max_miss_time) {
+	*hits = ghost_plan_hits;
+	*misses = ghost_plan_misses;
+	*max_miss_time = max_plan_miss_time;
 }
 
 int8_t is_game_over(void) {
@@ -886,4 +1415,56 @@ uint8_t is_powerup(void){
 	return powerup ; 
 }
 
+int8_t get_game_event(GameEvent* event) {
+	if(redraw_needed) {
+		redraw_needed = 0;
+		event_queue_length = 0;
+		event->type = GAME_EVENT_REDRAW;
+		return 1;
+	}
+	if(event_queue_length == 0) {
+		return 0;
+	}
+	*event = event_queue[event_queue_start];
+	event_queue_start = (event_queue_start + 1) % GAME_EVENT_QUEUE_SIZE;
+	event_queue_length--;
+	return 1;
+}
+
+const uint8_t* get_game_field(void) {
+	return game_field;
+}
+
+uint8_t get_pacman_x(void) {
+	return pacman_x;
+}
+
+uint8_t get_pacman_y(void) {
+	return pacman_y;
+}
+
+uint8_t get_pacman_direction(void) {
+	return pacman_direction;
+}
+
+uint8_t get_ghost_direction(int8_t ghostnum) {
+	return ghost_direction[ghostnum];
+}
+
+uint8_t get_ghost_x(int8_t ghostnum) {
+	return ghost_x[ghostnum];
+}
+
+uint8_t get_ghost_y(int8_t ghostnum) {
+	return ghost_y[ghostnum];
+}
+
+int8_t is_ghost_frightened(int8_t ghostnum) {
+	return (ghost_frightened >> ghostnum) & 1;
+}
+
+uint16_t get_pacdots_remaining(void) {
+	return num_pacdots;
+}
+
 
@@ -14,8 +14,22 @@
 // The game field is 31 rows in size by 31 columns.
 // The row number (y) ranges from 0 (top) to 30 (bottom)
 // The column number (x) ranges from 0 (left) to 30 (right)
+// A different size can be set at compile time (e.g. -DFIELD_WIDTH=63) - 
+// up to 255 in each direction since locations are stored in a uint8_t.
+// levels.c has mazes for a 31x31 field and a 47x31 one (-DFIELD_WIDTH=47).
+#ifndef FIELD_HEIGHT
 #define FIELD_HEIGHT 31
+#endif
+#ifndef FIELD_WIDTH
 #define FIELD_WIDTH 31
+#endif
+#if FIELD_WIDTH > 255 || FIELD_HEIGHT > 255
+#error "FIELD_WIDTH and FIELD_HEIGHT must be no more than 255"
+#endif
+
+// Terminal column where the game status (score etc.) is shown - just to
+// the right of the game field
+#define STATUS_X (FIELD_WIDTH + 6)
 
 // Number of ghosts in the game
 #define NUM_GHOSTS 4
@@ -27,17 +41,109 @@
 #define DIRN_RIGHT 2
 #define DIRN_DOWN 3
 
-// Arguments that can be passed to 
-
-// Initialise the game and output the initial display.
+// The game doesn't draw anything itself. As the game state changes, events
+// describing what changed are queued, and whatever is showing the game 
+// takes them with get_game_event() and draws the changes by looking at the
+// game state (using the functions further down). (project.c passes each
+// event on to the terminal display in game_display.c, to the LED matrix
+// map in led_map.c and to the sounds in sound.c.) If nothing takes the 
+// events the game just runs without being shown.
+//
+// Event types:
+#define GAME_EVENT_CELL_CHANGED 0	// What is at (x,y) has changed
+#define GAME_EVENT_SCORE_CHANGED 1	// Score (or high score or pac-dots remaining)
+#define GAME_EVENT_LIFE_LOST 2		// Ghost ghostnum caught the pac-man at (x,y)
+#define GAME_EVENT_GHOST_EATEN 3	// The pac-man ate ghost ghostnum at (x,y)
+#define GAME_EVENT_LEVEL_COMPLETE 4	// The last pac-dot has been eaten
+#define GAME_EVENT_REDRAW 5			// Everything has changed (e.g. new level)
+#define GAME_EVENT_PACDOT_EATEN 6	// The pac-man ate a pac-dot at (x,y) - the
+									// score has changed too
+#define GAME_EVENT_PELLET_EATEN 7	// The same for a power pellet
+
+typedef struct {
+	uint8_t type;
+	uint8_t x;
+	uint8_t y;
+	uint8_t ghostnum;
+} GameEvent;
+
+// Take the next event from the queue. Returns 1 if there was one (and 
+// event has been filled in), 0 if there are no events waiting. If the 
+// queue fills up the events in it are thrown away and the next event 
+// returned is GAME_EVENT_REDRAW.
+int8_t get_game_event(GameEvent* event);
+
+// Initialise the game (a GAME_EVENT_REDRAW is queued)
 void initialise_game(void); 
 
-// Initialise the game level - re-outputs the game field
+// Initialise the game level - queues a redraw of the game field
 // and restores all positions to their original values. This 
 // function is called by initialise_game() above and only 
 // needs to be called again if a new level is started.
 void initialise_game_level(void);
 
+// Move on to the next level (with the next maze) and initialise it as
+// for initialise_game_level(). After the last maze we start again from the
+// first maze.
+void initialise_next_level(void);
+
+// Return the current level number (0 for the first level)
+uint8_t get_level(void);
+
+// Return the number of milliseconds of game time since the game started
+uint32_t get_game_ticks(void);
+
+// The whole state of a game (everything needed to carry on from where it
+// is) can be saved into GAME_STATE_SIZE bytes and restored again later. 
+// Restoring queues a GAME_EVENT_REDRAW. The size depends on the largest maze
+// (see levels.h). 
+#define GAME_STATE_SIZE (59 + (MAX_WALKABLE_CELLS + 7) / 8)
+void save_game_state(uint8_t* buffer);
+
+// Returns 1 if a saved game state is safe to restore: the pac-man and 
+// ghosts are on the field and not in a wall of the level's maze, every
+// direction, mode and ghost mask is in range, the random number state
+// isn't 0 and the pac-dot count matches the pac-dots left. Returns 0 if
+// not. (This decodes the maze, so takes about as long as starting a level.)
+int8_t is_valid_game_state(const uint8_t* buffer);
+
+// Restore a saved game state. Returns 1 if successful, 0 (with nothing 
+// changed) if is_valid_game_state() rejects it.
+int8_t restore_game_state(const uint8_t* buffer);
+
+// Set or get the state of the random number generator used by the game
+// (e.g. the frightened ghosts). Setting the same state before the start of
+// a game makes the game play out the same way given the same input. A state
+// of 0 is not allowed (1 is used instead).
+void set_random_state(uint16_t state);
+uint16_t get_random_state(void);
+
+// Set or get how the ghosts play. GHOSTS_HARD ghosts look ahead and work
+// together when chasing the pac-man (see ghost_search.h). This is part of
+// the game state, so isn't changed by initialise_game() - set it before
+// starting a game, as for the random number state.
+#define GHOSTS_NORMAL 0
+#define GHOSTS_HARD 1
+void set_ghost_difficulty(uint8_t difficulty);
+uint8_t get_ghost_difficulty(void);
+
+// Time (in timer 1 counts, i.e. microseconds) RANDOM_COST_CALLS calls of 
+// the game's random number generator and of the C library random(). 
+// The game's random number generator state is left unchanged. This is
+// only built with RANDOM_COST_BENCH set to 1 at compile time - otherwise
+// random() (and the 32 bit arithmetic it needs) isn't linked in at all.
+#ifndef RANDOM_COST_BENCH
+#define RANDOM_COST_BENCH 0
+#endif
+#if RANDOM_COST_BENCH
+#define RANDOM_COST_CALLS 100
+void measure_random_cost(uint16_t* game_random_time, uint16_t* libc_random_time);
+#endif
+
+// Get the size (in bytes) of the compressed maze for the current level and
+// the time (in timer 1 counts, i.e. microseconds) it took to decode it.
+void get_maze_stats(uint16_t* encoded_size, uint16_t* decode_time);
+
 // Attempt to move the pacman in its current direction. Returns 1 if successful, 
 // 0 otherwise (e.g. there is a wall in the way, or the pacman would move into
 // a ghost). Nothing happens if the game is over. (0 is returned.)
@@ -57,7 +163,48 @@ int8_t change_pacman_direction(int8_t direction);
 // Nothing happens if the game is over.
 void move_ghost(int8_t ghostnum);
 
-// Returns 1 if the game is over, 0 otherwise
+// Move the game on by one millisecond of game time. The pac-man and the
+// ghosts move (using the functions above) once they have built up enough
+// progress at their current speeds to reach the next cell. Call this 
+// until get_game_time() catches up with get_current_time().
+void advance_game_time(void);
+
+// Return the game time (ms). This is set to the current time (from timer 0)
+// whenever a level is started.
+uint32_t get_game_time(void);
+
+// Change the game time without anything happening in the game, e.g. to
+// catch it up with the clock after the game has been run faster than real
+// time. Anything timed in the game (e.g. the ghost modes) moves with it.
+void set_game_time(uint32_t time);
+
+// Get the current speed of the pac-man or of a ghost (ghostnum is 0 to
+// NUM_GHOSTS - 1). Speeds are in 1/65536ths of a cell per millisecond and
+// depend on the level, whether the ghosts are frightened and whether the
+// ghost is in a tunnel.
+uint16_t get_pacman_speed(void);
+uint16_t get_ghost_speed(int8_t ghostnum);
+
+// Work out the next move of any ghost whose next move is not already known,
+// so that move_ghost() doesn't have to. This should be called on every pass
+// of the main loop. It stops once budget timer 1 counts (microseconds) have
+// been used and carries on from where it stopped on the next call. Planned
+// moves are thrown away whenever something they depend on changes.
+void plan_ghost_moves(uint16_t budget);
+
+// Returns 1 if there are ghost moves which plan_ghost_moves() hasn't worked
+// out yet, 0 if it would have nothing to do (always once the game is over
+// or the level is complete, so the CPU can sleep while waiting for a 
+// button)
+int8_t ghost_moves_to_plan(void);
+
+// Get the number of ghost moves that were planned ahead of time (hits) and
+// the number that had to be worked out when the ghost moved (misses), and
+// the longest a miss has taken (timer 1 counts, i.e. microseconds) - the
+// worst case for the ghosts' part of advance_game_time().
+void get_ghost_plan_stats(uint16_t* hits, uint16_t* misses, uint16_t* max_miss_time);
+
+// Returns 1 if the game is over (the last life has been lost), 0 otherwise
 // Must only be called after initialise_game().
 int8_t is_game_over(void);
 
@@ -65,6 +212,33 @@ int8_t is_game_over(void);
 // Must only be called after initialise_game().
 int8_t is_level_complete(void);
 
+// The state of the game, for drawing it (or playing it - see autopilot.h).
+// get_game_field() returns the current level's maze (in program memory - 
+// see maze.h) and is_pacdot_at()/is_pellet_at()/is_wall_at() return 1 if 
+// there is a pac-dot/power pellet (which hasn't been eaten)/wall at (x,y).
+const uint8_t* get_game_field(void);
+int8_t is_pacdot_at(uint8_t x, uint8_t y);
+int8_t is_pellet_at(uint8_t x, uint8_t y);
+int8_t is_wall_at(uint8_t x, uint8_t y);
+uint8_t get_pacman_x(void);
+uint8_t get_pacman_y(void);
+uint8_t get_pacman_direction(void);
+uint8_t get_ghost_direction(int8_t ghostnum);
+uint8_t get_ghost_x(int8_t ghostnum);
+uint8_t get_ghost_y(int8_t ghostnum);
+int8_t is_ghost_frightened(int8_t ghostnum);
+uint16_t get_pacdots_remaining(void);
+
+// Work out the location of the cell one from (x,y) in the given direction. 
+// Moving off the left or right edge of a tunnel row wraps around to the 
+// other side. Returns 1 and sets *new_x and *new_y if this is on the game 
+// field, otherwise returns 0.
+int8_t cell_in_dirn(uint8_t x, uint8_t y, uint8_t direction, uint8_t* new_x, uint8_t* new_y);
+
+// Returns 1 if (x,y) is in the ghosts' home (including its entry). The 
+// pac-man can't go in and ghosts don't go back in once they've left.
+int8_t is_ghost_home(uint8_t x, uint8_t y);
+
 //Return number of lives pacman has left
 uint8_t get_lives(void); 
 
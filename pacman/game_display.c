@@ -0,0 +1,179 @@
+/*
+ * game_display.c
+ *
+ * Terminal display of the game. Nothing here changes the game - it only
+ * looks at the game state when an event says something has changed.
+ */
+
+#include <stdio.h>
+#include <avr/pgmspace.h>
+
+#include "game_display.h"
+#include "game.h"
+#include "maze.h"
+#include "score.h"
+#include "terminalio.h"
+#include "line_drawing_characters.h"
+
+// Terminal colours to be used (in program memory - read them with 
+// pgm_read_byte())
+static const uint8_t ghost_colours[NUM_GHOSTS] PROGMEM = {
+	BG_RED, BG_GREEN, BG_CYAN, BG_MAGENTA
+};
+#define PACMAN_COLOUR (FG_YELLOW)
+#define FRIGHTENED_GHOST_COLOUR (BG_BLUE)
+
+// Unicode characters used to represent the pacman in each direction, and
+// the line drawing character for each class of wall (from 
+// CELL_CLASS_FIRST_WALL on). These are kept in program memory - each one is
+// 3 bytes of UTF-8 and a null - and output with fputs_P().
+#define UTF8_CHARACTER_SIZE 4
+static const char pacman_characters[NUM_DIRECTION_VALUES][UTF8_CHARACTER_SIZE] PROGMEM = {
+	"\u15E4", "\u15E2", "\u15E7", "\u15E3"
+};
+static const char wall_characters[CELL_CLASS_FILLED - CELL_CLASS_FIRST_WALL][UTF8_CHARACTER_SIZE] PROGMEM = {
+	LINE_HORIZONTAL, LINE_VERTICAL,
+	LINE_DOWN_AND_RIGHT, LINE_DOWN_AND_LEFT, LINE_UP_AND_RIGHT, LINE_UP_AND_LEFT,
+	LINE_VERTICAL_AND_RIGHT, LINE_VERTICAL_AND_LEFT,
+	LINE_HORIZONTAL_AND_UP, LINE_HORIZONTAL_AND_DOWN,
+	LINE_VERTICAL_AND_HORIZONTAL
+};
+
+// Output the whole game field. The maze is decoded again as it is output 
+// so no copy of it is needed. Any pac-dots and pellets already eaten are 
+// not shown.
+static void draw_game_field(void) {
+	MazeDecoder decoder;
+	move_cursor(1,1);	// Start at top left
+	maze_decoder_start(&decoder, get_game_field());
+	for(uint8_t y = 0; y < FIELD_HEIGHT; y++) {
+		for(uint8_t x = 0; x < FIELD_WIDTH; x++) {
+			uint8_t cell_class = maze_decoder_next(&decoder);
+			if(cell_class < CELL_CLASS_FIRST_WALL) {
+				// Only show pac-dots and pellets which haven't been eaten
+				if(is_pacdot_at(x, y)) {
+					cell_class = CELL_CLASS_PACDOT;
+				} else if(is_pellet_at(x, y)) {
+					cell_class = CELL_CLASS_PELLET;
+				} else {
+					cell_class = CELL_CLASS_SPACE;
+				}
+			}
+			if(cell_class >= CELL_CLASS_FIRST_WALL && cell_class < CELL_CLASS_FILLED) {
+				fputs_P(wall_characters[cell_class - CELL_CLASS_FIRST_WALL], stdout);
+				continue;
+			}
+			switch(cell_class) {
+				case CELL_CLASS_SPACE:
+				case CELL_CLASS_FILLED:	printf(" "); break;
+				case CELL_CLASS_PELLET:	printf("P"); break;	// power-pellet
+				case CELL_CLASS_PACDOT:	printf("."); break;	// pac-dot
+				default:	printf("x"); break;	// shouldn't happen but we show an x in case it does
+			}
+		}
+		printf("\n");
+	}
+}
+
+// Draw whatever is at (x,y) - the pac-man (facing the way it is going), a
+// ghost (shown as a block of the ghost's colour, with any pac-dot or pellet
+// showing through) or a pac-dot, pellet or space. If a ghost and the 
+// pac-man are both there then the pac-man is drawn on the ghost's colour.
+static void draw_cell(uint8_t x, uint8_t y) {
+	move_cursor(x+1, y+1);
+	for(int8_t i = 0; i < NUM_GHOSTS; i++) {
+		if(get_ghost_x(i) == x && get_ghost_y(i) == y) {
+			if(is_ghost_frightened(i)) {
+				set_display_attribute(FRIGHTENED_GHOST_COLOUR);
+			} else {
+				set_display_attribute(pgm_read_byte(&ghost_colours[i]));
+			}
+			break;
+		}
+	}
+	if(get_pacman_x() == x && get_pacman_y() == y) {
+		set_display_attribute(PACMAN_COLOUR);
+		fputs_P(pacman_characters[get_pacman_direction()], stdout);
+	} else if(is_pacdot_at(x, y)) {
+		printf(".");
+	} else if(is_pellet_at(x, y)) {
+		printf("P");
+	} else {
+		printf(" ");
+	}
+	// Return to normal display mode to ensure we don't use this
+	// background colour for any other printing
+	normal_display_mode();
+}
+
+// The pac-man has met a ghost at (x,y). If the pac-man is still there we
+// draw it on the background colour the ghost had (though the ghost has 
+// gone home).
+static void draw_meeting(const GameEvent* event, uint8_t colour) {
+	if(get_pacman_x() == event->x && get_pacman_y() == event->y) {
+		move_cursor(event->x + 1, event->y + 1);
+		set_display_attribute(colour);
+		set_display_attribute(PACMAN_COLOUR);
+		fputs_P(pacman_characters[get_pacman_direction()], stdout);
+		normal_display_mode();
+	}
+}
+
+static void draw_lives(void) {
+	move_cursor(STATUS_X, 5);
+	printf_P(PSTR("Lives: %5d"), get_lives());
+}
+
+static void draw_score(void) {
+	move_cursor(STATUS_X, 8);
+	printf_P(PSTR("     Score: "));
+	move_cursor(STATUS_X, 9);
+	printf_P(PSTR("%11lu"), get_score());
+	move_cursor(STATUS_X, 10);
+	printf_P(PSTR("High Score:"));
+	move_cursor(STATUS_X, 11);
+	printf_P(PSTR("%11lu"), get_highscore());
+	move_cursor(STATUS_X, 13);
+	printf_P(PSTR("Pacdots Remaining: %11d"), get_pacdots_remaining());
+}
+
+// Clear the screen and draw everything
+static void draw_everything(void) {
+	clear_terminal();
+	normal_display_mode();
+	hide_cursor();
+	draw_game_field();
+	for(int8_t i = 0; i < NUM_GHOSTS; i++) {
+		draw_cell(get_ghost_x(i), get_ghost_y(i));
+	}
+	draw_cell(get_pacman_x(), get_pacman_y());
+	move_cursor(STATUS_X, 3);
+	printf_P(PSTR("Level: %5d"), get_level() + 1);
+	draw_lives();
+	draw_score();
+}
+
+int8_t display_game_event(const GameEvent* event) {
+	switch(event->type) {
+		case GAME_EVENT_CELL_CHANGED:
+			draw_cell(event->x, event->y);
+			break;
+		case GAME_EVENT_SCORE_CHANGED:
+		case GAME_EVENT_PACDOT_EATEN:
+		case GAME_EVENT_PELLET_EATEN:
+			draw_score();
+			break;
+		case GAME_EVENT_LIFE_LOST:
+			draw_meeting(event, pgm_read_byte(&ghost_colours[event->ghostnum]));
+			draw_lives();
+			break;
+		case GAME_EVENT_GHOST_EATEN:
+			draw_meeting(event, FRIGHTENED_GHOST_COLOUR);
+			break;
+		case GAME_EVENT_REDRAW:
+			draw_everything();
+			return 1;
+		// (The level being complete is shown by project.c)
+	}
+	return 0;
+}
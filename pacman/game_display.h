@@ -0,0 +1,20 @@
+/*
+ * game_display.h
+ *
+ * Shows the game on the terminal (using ANSI escape sequences) by taking
+ * the events queued by the game (see get_game_event() in game.h) and
+ * drawing what they say has changed.
+ */
+
+#ifndef GAME_DISPLAY_H_
+#define GAME_DISPLAY_H_
+
+#include <stdint.h>
+#include "game.h"
+
+// Draw what the given event (taken from get_game_event()) says has changed.
+// Returns 1 if the whole screen was cleared and redrawn (so anything else
+// on the screen needs to be shown again), 0 otherwise.
+int8_t display_game_event(const GameEvent* event);
+
+#endif /* GAME_DISPLAY_H_ */
@@ -0,0 +1,543 @@
+/*
+ * ghost_search.c
+ *
+ * Look-ahead for hard ghosts - see ghost_search.h
+ */
+
+#include "ghost_search.h"
+#include "game.h"
+#include "bitboard.h"
+#include "scratch.h"
+#include "timer1.h"
+
+// Most junctions the pac-man is followed to - one for each way out of
+// where it is after 1 corridor, and up to 4 more from each of those after
+// 2. Each has a bit in a uint32_t so this can be no more than 32. Any more
+// that the pac-man could get to are left out.
+#if PACMAN_SEARCH_DEPTH == 1
+#define MAX_PACMAN_JUNCTIONS 4
+#elif PACMAN_SEARCH_DEPTH == 2
+#define MAX_PACMAN_JUNCTIONS 20
+#else
+#define MAX_PACMAN_JUNCTIONS 32
+#endif
+
+// A set of pac-man junctions - bit n for pacman_junctions[n]. As small as
+// MAX_PACMAN_JUNCTIONS allows, since the search does a lot with them.
+#if MAX_PACMAN_JUNCTIONS <= 8
+typedef uint8_t JunctionSet;
+#define JUNCTION_SET_BYTES 1
+#else
+typedef uint32_t JunctionSet;
+#define JUNCTION_SET_BYTES 4
+#endif
+
+// Most paths (ways to go, up to GHOST_SEARCH_DEPTH corridors long) kept
+// for each ghost. A ghost at a junction has up to 3 exits (it can't turn
+// back) so this is all of them up to a depth of 2. Any more are left out.
+#if GHOST_SEARCH_DEPTH == 1
+#define MAX_GHOST_PATHS 3
+#elif GHOST_SEARCH_DEPTH == 2
+#define MAX_GHOST_PATHS 9
+#else
+#define MAX_GHOST_PATHS 27
+#endif
+
+// Number of corridors remembered (see below). Corridors are looked up by
+// where they start so only a few collide. With the autopilot playing hard
+// ghosts (tools/ghost_tune.sh) 43% of the corridors followed are already
+// known - 56% with twice as many, which isn't worth another 112 bytes of
+// RAM.
+#ifndef CORRIDOR_CACHE_SIZE
+#define CORRIDOR_CACHE_SIZE 16
+#endif
+
+// Value of x for a corridor cache entry that isn't in use (and of
+// pacman_searched_x when the pac-man's junctions aren't known)
+#define NOT_SEARCHED 0xFF
+
+// A corridor is followed from (x,y) heading in the given direction until
+// it reaches a junction (or a dead end) at (end_x,end_y), length cells
+// later, arriving heading in end_direction.
+typedef struct {
+	uint8_t x;
+	uint8_t y;
+	uint8_t direction;
+	uint8_t end_x;
+	uint8_t end_y;
+	uint8_t end_direction;
+	uint8_t length;
+} Corridor;
+
+typedef struct {
+	uint8_t x;
+	uint8_t y;
+	uint8_t distance;	// Cells from the pac-man
+} PacmanJunction;
+
+// The paths of each ghost in the search. The deciding ghost is in slot 0
+// (and the direction each of its paths starts in is kept) and the other
+// ghosts near enough to matter follow. Only the junctions a path gets to
+// before the pac-man are kept, and a path that gets to no more than 
+// another of the same ghost's (starting the same way) is left out.
+// reach[n] is every junction the ghosts in slots n and on could get to.
+typedef struct {
+	JunctionSet covered[NUM_GHOSTS][MAX_GHOST_PATHS];
+	JunctionSet reach[NUM_GHOSTS + 1];
+	uint8_t first_direction[MAX_GHOST_PATHS];
+	uint8_t num_paths[NUM_GHOSTS];
+	uint8_t num_slots;
+} GhostPaths;
+
+// These are worked out afresh for each search, so are kept in the scratch
+// RAM (see scratch.h) - unless they don't fit, which can only happen with
+// bigger search depths than the AVR has room for anyway (e.g. tuning on
+// the host).
+#define GHOST_PATHS_SIZE ((NUM_GHOSTS * MAX_GHOST_PATHS + NUM_GHOSTS + 1) * \
+		JUNCTION_SET_BYTES + MAX_GHOST_PATHS + NUM_GHOSTS + 1)
+#if GHOST_PATHS_SIZE <= SCRATCH_SIZE
+#define ghost_paths() ((GhostPaths*)scratch.bytes)
+#else
+static GhostPaths big_ghost_paths;
+#define ghost_paths() (&big_ghost_paths)
+#endif
+
+// The maze the corridors below are for. They are forgotten when it
+// changes.
+static const uint8_t* search_field;
+
+// Corridors followed recently
+static Corridor corridor_cache[CORRIDOR_CACHE_SIZE];
+
+// The junctions the pac-man could get to within PACMAN_SEARCH_DEPTH
+// corridors (at the nearest distance) from (pacman_searched_x,
+// pacman_searched_y). Kept until the pac-man moves since this is the same
+// for every ghost.
+static PacmanJunction pacman_junctions[MAX_PACMAN_JUNCTIONS];
+static uint8_t num_pacman_junctions;
+static uint8_t furthest_pacman_junction;
+static uint8_t pacman_searched_x = NOT_SEARCHED;
+static uint8_t pacman_searched_y;
+
+// The corridors out from where the pac-man is (one for each way it can go,
+// up to the first junction). pacman_corridor_end is the index in
+// pacman_junctions of the junction at the other end (NOT_SEARCHED if it
+// isn't there) and pacman_corridor_entry the direction a ghost at that
+// junction heads in to come along the corridor towards the pac-man.
+static uint8_t num_pacman_corridors;
+static uint8_t pacman_corridor_end[NUM_DIRECTION_VALUES];
+static uint8_t pacman_corridor_entry[NUM_DIRECTION_VALUES];
+
+// Nodes (corridors followed and combinations of paths tried) in the search
+// so far. This, not the time, is what the search is cut short by, so that
+// a move only depends on the game state.
+static uint16_t search_steps;
+
+static uint16_t num_searches;
+static uint16_t max_search_time;
+static uint16_t max_steps;
+static uint16_t searches_cut_short;
+static uint16_t corridor_hits;
+static uint16_t corridor_misses;
+
+// Returns 1 if (x,y) can be moved into by a ghost outside the ghost home
+// (or by the pac-man)
+static int8_t is_open(uint8_t x, uint8_t y) {
+	return !is_wall_at(x, y) && !is_ghost_home(x, y);
+}
+
+// Returns a bit mask of the directions that can be moved in from (x,y)
+static uint8_t open_exits(uint8_t x, uint8_t y) {
+	uint8_t exits = 0;
+	uint8_t new_x, new_y;
+	for(uint8_t direction = 0; direction < NUM_DIRECTION_VALUES; direction++) {
+		if(cell_in_dirn(x, y, direction, &new_x, &new_y) && is_open(new_x, new_y)) {
+			exits |= (1 << direction);
+		}
+	}
+	return exits;
+}
+
+// Forget the corridors of the last maze
+static void new_search_field(void) {
+	search_field = get_game_field();
+	for(uint8_t i = 0; i < CORRIDOR_CACHE_SIZE; i++) {
+		corridor_cache[i].x = NOT_SEARCHED;
+	}
+	pacman_searched_x = NOT_SEARCHED;
+}
+
+// Find the corridor starting from (x,y) heading in the given direction
+// (which must be open), following it cell by cell if we don't already know
+// where it goes
+static const Corridor* follow_corridor(uint8_t x, uint8_t y, uint8_t direction) {
+	Corridor* corridor = &corridor_cache[(uint8_t)(x * 3 + y * 7 + direction) % CORRIDOR_CACHE_SIZE];
+	if(corridor->x == x && corridor->y == y && corridor->direction == direction) {
+		corridor_hits++;
+		return corridor;
+	}
+	corridor_misses++;
+	corridor->x = x;
+	corridor->y = y;
+	corridor->direction = direction;
+	corridor->length = 0;
+	while(corridor->length < UINT8_MAX) {
+		cell_in_dirn(x, y, direction, &x, &y);
+		corridor->length++;
+		// Stop at a junction (3 or more ways out). Otherwise carry on round
+		// any corner - unless it's a dead end.
+		uint8_t exits = open_exits(x, y);
+		if(bitboard_count_byte(exits) >= 3) {
+			break;
+		}
+		exits &= ~(1 << ((direction + 2) % 4));
+		if(exits == 0) {
+			break;
+		}
+		for(direction = 0; !(exits & (1 << direction)); direction++) {
+			;
+		}
+	}
+	corridor->end_x = x;
+	corridor->end_y = y;
+	corridor->end_direction = direction;
+	return corridor;
+}
+
+// Return the index in pacman_junctions of (x,y), or num_pacman_junctions
+// if it isn't there
+static uint8_t find_pacman_junction(uint8_t x, uint8_t y) {
+	uint8_t i;
+	for(i = 0; i < num_pacman_junctions; i++) {
+		if(pacman_junctions[i].x == x && pacman_junctions[i].y == y) {
+			break;
+		}
+	}
+	return i;
+}
+
+// Follow the pac-man from (x,y), distance cells away, heading in the given
+// direction for up to depth more corridors. The pac-man can turn around at
+// any time so it can take any exit from a junction.
+static void add_pacman_junctions(uint8_t x, uint8_t y, uint8_t direction,
+		uint8_t distance, uint8_t depth) {
+	const Corridor* corridor = follow_corridor(x, y, direction);
+	if(corridor->length > UINT8_MAX - distance) {
+		return;
+	}
+	distance += corridor->length;
+	x = corridor->end_x;
+	y = corridor->end_y;
+	uint8_t i = find_pacman_junction(x, y);
+	if(i < num_pacman_junctions) {
+		if(pacman_junctions[i].distance <= distance) {
+			// Already been here as quickly - no need to look again
+			return;
+		}
+	} else if(num_pacman_junctions < MAX_PACMAN_JUNCTIONS) {
+		num_pacman_junctions++;
+		pacman_junctions[i].x = x;
+		pacman_junctions[i].y = y;
+	} else {
+		return;
+	}
+	pacman_junctions[i].distance = distance;
+	if(distance > furthest_pacman_junction) {
+		furthest_pacman_junction = distance;
+	}
+	if(--depth > 0) {
+		uint8_t exits = open_exits(x, y);
+		for(direction = 0; direction < NUM_DIRECTION_VALUES; direction++) {
+			if(exits & (1 << direction)) {
+				add_pacman_junctions(x, y, direction, distance, depth);
+			}
+		}
+	}
+}
+
+// Work out the junctions the pac-man could get to (unless we already know
+// them for where the pac-man is now)
+static void find_pacman_junctions(void) {
+	uint8_t x = get_pacman_x();
+	uint8_t y = get_pacman_y();
+	if(x == pacman_searched_x && y == pacman_searched_y) {
+		return;
+	}
+	pacman_searched_x = x;
+	pacman_searched_y = y;
+	num_pacman_junctions = 0;
+	furthest_pacman_junction = 0;
+	num_pacman_corridors = 0;
+	uint8_t exits = open_exits(x, y);
+	for(uint8_t direction = 0; direction < NUM_DIRECTION_VALUES; direction++) {
+		if(exits & (1 << direction)) {
+			add_pacman_junctions(x, y, direction, 0, PACMAN_SEARCH_DEPTH);
+		}
+	}
+	// (Once all the junctions are in, so that the indexes don't change)
+	for(uint8_t direction = 0; direction < NUM_DIRECTION_VALUES; direction++) {
+		if(exits & (1 << direction)) {
+			const Corridor* corridor = follow_corridor(x, y, direction);
+			uint8_t i = find_pacman_junction(corridor->end_x, corridor->end_y);
+			pacman_corridor_end[num_pacman_corridors] = (i < num_pacman_junctions) ? i : NOT_SEARCHED;
+			pacman_corridor_entry[num_pacman_corridors] = (corridor->end_direction + 2) % 4;
+			num_pacman_corridors++;
+		}
+	}
+}
+
+// A ghost at the junction (x,y) heading along the corridor in the given
+// direction. If that's one of the pac-man's corridors the ghost will meet
+// the pac-man head on, so the pac-man can't get out past it: return the
+// junction (bit n for pacman_junctions[n]), otherwise 0. 
+static JunctionSet junction_blocked_by(uint8_t x, uint8_t y, uint8_t direction) {
+	for(uint8_t i = 0; i < num_pacman_corridors; i++) {
+		uint8_t end = pacman_corridor_end[i];
+		if(end != NOT_SEARCHED && pacman_corridor_entry[i] == direction &&
+				pacman_junctions[end].x == x && pacman_junctions[end].y == y) {
+			return (JunctionSet)1 << end;
+		}
+	}
+	return 0;
+}
+
+// Return the exits a ghost at (x,y) heading in the given direction can
+// take - any but back the way it came, unless that's the only way
+static uint8_t ghost_exits(uint8_t x, uint8_t y, uint8_t direction) {
+	uint8_t exits = open_exits(x, y);
+	uint8_t reverse = 1 << ((direction + 2) % 4);
+	if(exits & ~reverse) {
+		return exits & ~reverse;
+	}
+	return exits;
+}
+
+// Add a path to those of the ghost in the given slot, unless it is no
+// better than one it already has (starting the same way). One it is better
+// than is replaced.
+static void add_ghost_path(GhostPaths* paths, uint8_t slot, uint8_t first_direction,
+		JunctionSet covered) {
+	JunctionSet* sets = paths->covered[slot];
+	uint8_t n = paths->num_paths[slot];
+	for(uint8_t i = 0; i < n; i++) {
+		if(slot == 0 && paths->first_direction[i] != first_direction) {
+			continue;
+		}
+		if((covered & ~sets[i]) == 0) {
+			return;
+		}
+		if((sets[i] & ~covered) == 0) {
+			sets[i] = covered;
+			return;
+		}
+	}
+	if(n < MAX_GHOST_PATHS) {
+		sets[n] = covered;
+		if(slot == 0) {
+			paths->first_direction[n] = first_direction;
+		}
+		paths->num_paths[slot] = n + 1;
+	}
+}
+
+// Follow a ghost from (x,y), distance cells away, heading in the given
+// direction for up to depth more corridors, and add each path it could
+// take (having got to the junctions in covered first so far). A path ends
+// early once the ghost is further away than the pac-man could be, or the
+// search has had MAX_SEARCH_STEPS nodes.
+static void add_ghost_paths(GhostPaths* paths, uint8_t slot, uint8_t first_direction,
+		uint8_t x, uint8_t y, uint8_t direction, uint8_t distance, uint8_t depth,
+		JunctionSet covered) {
+	const Corridor* corridor = follow_corridor(x, y, direction);
+	search_steps += corridor->length;
+	if(corridor->length <= furthest_pacman_junction - distance) {
+		distance += corridor->length;
+		x = corridor->end_x;
+		y = corridor->end_y;
+		uint8_t i = find_pacman_junction(x, y);
+		if(i < num_pacman_junctions && distance <= pacman_junctions[i].distance) {
+			covered |= (JunctionSet)1 << i;
+		}
+		if(--depth > 0 && search_steps < MAX_SEARCH_STEPS) {
+			uint8_t exits = ghost_exits(x, y, corridor->end_direction);
+			for(direction = 0; direction < NUM_DIRECTION_VALUES; direction++) {
+				if(exits & (1 << direction)) {
+					add_ghost_paths(paths, slot, first_direction, x, y, direction,
+							distance, depth, covered);
+				}
+			}
+			return;
+		}
+	}
+	add_ghost_path(paths, slot, first_direction, covered);
+}
+
+// Add the paths of a ghost at (x,y), taking any of the given exits 
+// (starting with first_choice, then round the others in order), as the next
+// slot. Going along one of the pac-man's corridors blocks the junction the
+// ghost is at as well as heading for the far end. A ghost other than the
+// deciding one (in slot 0) that can't get anywhere first is left out.
+static void add_ghost(GhostPaths* paths, uint8_t x, uint8_t y, uint8_t exits,
+		uint8_t first_choice) {
+	uint8_t slot = paths->num_slots;
+	paths->num_paths[slot] = 0;
+	for(uint8_t i = 0; i < NUM_DIRECTION_VALUES; i++) {
+		uint8_t direction = (first_choice + i) % NUM_DIRECTION_VALUES;
+		if((exits & (1 << direction)) && search_steps < MAX_SEARCH_STEPS) {
+			add_ghost_paths(paths, slot, direction, x, y, direction, 0,
+					GHOST_SEARCH_DEPTH, junction_blocked_by(x, y, direction));
+		}
+	}
+	if(slot > 0 && paths->num_paths[slot] == 1 && paths->covered[slot][0] == 0) {
+		return;
+	}
+	if(paths->num_paths[slot] > 0) {
+		paths->num_slots++;
+	}
+}
+
+// Return how many cells the given ghost is beyond being able to get to any
+// of the pac-man junctions first - the number of moves it can make, 
+// carrying on the way it's going, before it might. 0 if it can already
+// (or it's at home, where it could be about to come out).
+static uint8_t cells_out_of_reach(uint8_t ghostnum) {
+	uint8_t x = get_ghost_x(ghostnum);
+	uint8_t y = get_ghost_y(ghostnum);
+	uint8_t margin = UINT8_MAX;
+	if(is_ghost_home(x, y)) {
+		return 0;
+	}
+	uint8_t exits = ghost_exits(x, y, get_ghost_direction(ghostnum));
+	for(uint8_t direction = 0; direction < NUM_DIRECTION_VALUES; direction++) {
+		if(exits & (1 << direction)) {
+			uint8_t length = follow_corridor(x, y, direction)->length;
+			if(length <= furthest_pacman_junction) {
+				return 0;
+			}
+			if(length - furthest_pacman_junction < margin) {
+				margin = length - furthest_pacman_junction;
+			}
+		}
+	}
+	return margin;
+}
+
+// Number of pac-man junctions the ghosts can't get to first
+static uint8_t count_escapes(JunctionSet covered, JunctionSet all) {
+	return bitboard_count_word(all & ~covered);
+}
+
+// Return the fewest escapes the ghosts in slots from slot on can leave the
+// pac-man between them, with the junctions in covered already covered by
+// the ghosts before them - or limit if they can't leave fewer than that.
+// Combinations that can't beat the best so far (even if the ghosts got to
+// everywhere they could) aren't tried.
+static uint8_t fewest_escapes(const GhostPaths* paths, uint8_t slot, JunctionSet covered,
+		JunctionSet all, uint8_t limit) {
+	if(slot == paths->num_slots) {
+		return count_escapes(covered, all);
+	}
+	uint8_t least_possible = count_escapes(covered | paths->reach[slot], all);
+	for(uint8_t i = 0; i < paths->num_paths[slot] && limit > least_possible; i++) {
+		if(search_steps >= MAX_SEARCH_STEPS) {
+			break;
+		}
+		search_steps++;
+		uint8_t escapes = fewest_escapes(paths, slot + 1, covered | paths->covered[slot][i],
+				all, limit);
+		if(escapes < limit) {
+			limit = escapes;
+		}
+	}
+	return limit;
+}
+
+int8_t ghost_search_direction(uint8_t ghostnum, uint8_t exits, int8_t normal_choice,
+		uint8_t* ghosts_read, uint8_t* free_moves) {
+	uint16_t start_time = get_timer1_count();
+	GhostPaths* paths = ghost_paths();
+	int8_t best_direction = normal_choice;
+	uint8_t best_escapes;
+	JunctionSet all;
+
+	if(search_field != get_game_field()) {
+		new_search_field();
+	}
+	find_pacman_junctions();
+	all = (num_pacman_junctions == 8 * JUNCTION_SET_BYTES) ? (JunctionSet)-1 :
+			((JunctionSet)1 << num_pacman_junctions) - 1;
+
+	// This ghost's paths go first - the normal choice first of all, so that
+	// it's kept unless another is better
+	search_steps = 0;
+	paths->num_slots = 0;
+	add_ghost(paths, get_ghost_x(ghostnum), get_ghost_y(ghostnum), exits, normal_choice);
+
+	// Then the other ghosts'. Frightened ghosts don't count, and nor do
+	// ghosts too far away to get anywhere first - until they have made 
+	// enough moves to be close enough.
+	*ghosts_read = 0;
+	*free_moves = GHOST_MOVES_UNLIMITED;
+	for(uint8_t i = 0; i < NUM_GHOSTS; i++) {
+		if(i == ghostnum || is_ghost_frightened(i)) {
+			continue;
+		}
+		uint8_t margin = cells_out_of_reach(i);
+		if(margin > 0) {
+			if(margin - 1 < *free_moves) {
+				*free_moves = margin - 1;
+			}
+		} else {
+			*ghosts_read |= (1 << i);
+			uint8_t x = get_ghost_x(i);
+			uint8_t y = get_ghost_y(i);
+			if(!is_ghost_home(x, y)) {
+				add_ghost(paths, x, y, ghost_exits(x, y, get_ghost_direction(i)), 0);
+			}
+		}
+	}
+	paths->reach[paths->num_slots] = 0;
+	for(uint8_t slot = paths->num_slots; slot-- > 0; ) {
+		paths->reach[slot] = paths->reach[slot + 1];
+		for(uint8_t i = 0; i < paths->num_paths[slot]; i++) {
+			paths->reach[slot] |= paths->covered[slot][i];
+		}
+	}
+
+	// Try each of this ghost's paths with every combination of the other 
+	// ghosts' and take the way that can leave the pac-man the fewest
+	// escapes (the first found, so the normal choice on a tie)
+	best_escapes = count_escapes(0, all) + 1;
+	if(paths->num_slots > 0) {
+		for(uint8_t i = 0; i < paths->num_paths[0] && best_escapes > 0; i++) {
+			uint8_t escapes = fewest_escapes(paths, 1, paths->covered[0][i], all,
+					best_escapes);
+			if(escapes < best_escapes) {
+				best_escapes = escapes;
+				best_direction = paths->first_direction[i];
+			}
+		}
+	}
+
+	num_searches++;
+	if(search_steps > max_steps) {
+		max_steps = search_steps;
+	}
+	if(search_steps >= MAX_SEARCH_STEPS) {
+		searches_cut_short++;
+	}
+	if((uint16_t)(get_timer1_count() - start_time) > max_search_time) {
+		max_search_time = get_timer1_count() - start_time;
+	}
+	return best_direction;
+}
+
+void get_ghost_search_stats(uint16_t* searches, uint16_t* max_time,
+		uint16_t* most_steps, uint16_t* cut_short, uint16_t* hits, uint16_t* misses) {
+	*searches = num_searches;
+	*max_time = max_search_time;
+	*most_steps = max_steps;
+	*cut_short = searches_cut_short;
+	*hits = corridor_hits;
+	*misses = corridor_misses;
+}
@@ -0,0 +1,99 @@
+/*
+ * ghost_search.h
+ *
+ * Decisions for "hard" ghosts (see set_ghost_difficulty() in game.h).
+ * Normally each ghost heads for its own target tile and takes no notice of
+ * what the others are doing. A hard ghost at a junction instead looks ahead
+ * along the maze, junction to junction, together with the other ghosts.
+ *
+ * The pac-man is predicted to go anywhere it can within PACMAN_SEARCH_DEPTH
+ * corridors, and each junction it could get to is an escape unless a ghost
+ * can get there first. Each ghost near enough to matter could take any of
+ * its paths (up to GHOST_SEARCH_DEPTH corridors, not turning back). The
+ * ghost searches every combination of its own paths with one path for 
+ * each of the other ghosts for the one that leaves the pac-man the fewest
+ * escapes, and takes the first corridor of its own path in that. So the 
+ * ghosts close in from different sides rather than following each other,
+ * and two ghosts don't both count on the other to cover a junction. (Each
+ * ghost searches again at its next junction, so they only carry on with 
+ * the same combination if nothing better has turned up.) A ghost heading
+ * along one of the pac-man's corridors towards it also cuts off the 
+ * junction it came from.
+ *
+ * The search is pruned: a path that gets to no more junctions first than
+ * another of the same ghost's is dropped, and a combination is given up as
+ * soon as it couldn't beat the best so far even if the remaining ghosts got
+ * everywhere they could. The corridors between junctions most recently
+ * followed are remembered (until the maze changes).
+ *
+ * With the depths below tools/ghost_tune.sh has the autopilot losing 1.9
+ * times as many lives a minute to hard ghosts as to normal ones (1.74 to 
+ * 0.93, over 100 games).
+ *
+ * Distances are in cells (the ghosts and the pac-man are taken to move at
+ * the same speed) and the search only depends on the game state, so a game
+ * with hard ghosts is still deterministic. That's why the work is limited
+ * by MAX_SEARCH_STEPS rather than by time.
+ */
+
+#ifndef GHOST_SEARCH_H_
+#define GHOST_SEARCH_H_
+
+#include <stdint.h>
+
+// Number of corridors (junction to junction) looked ahead for the ghosts
+// and for the pac-man. The work goes up by about 3 times for each extra 
+// corridor. These can be set at compile time - tools/ghost_tune.sh tries
+// them out on the host to see how hard they make the game. (Looking further
+// ahead for the pac-man counts junctions it would take a long time to get
+// to, which makes the ghosts spread out rather than close in.)
+#ifndef GHOST_SEARCH_DEPTH
+#define GHOST_SEARCH_DEPTH 2
+#endif
+#ifndef PACMAN_SEARCH_DEPTH
+#define PACMAN_SEARCH_DEPTH 1
+#endif
+
+// Most steps a search takes - a step is a cell along a corridor followed
+// for a ghost (counted whether or not the corridor was already known, so
+// the limit doesn't depend on what happens to be remembered) or a 
+// combination of paths tried. A search that gets to the limit takes the 
+// best it has found so far (it can go over by the length of one corridor).
+// The time taken by the rest - finding the pac-man's junctions and which
+// ghosts are near enough - is bounded by the depths (up to 4 and 9 
+// corridors with the depths above). With the depths above no search needs
+// more than 214 steps over 100 games; with a limit of 128 5% of them are
+// cut short with no difference to how hard the ghosts are (even 64, 
+// cutting 64% short, makes little). get_ghost_search_stats() shows the
+// most taken.
+#ifndef MAX_SEARCH_STEPS
+#define MAX_SEARCH_STEPS 128
+#endif
+
+// Value of *free_moves below when moves of the other ghosts make no 
+// difference
+#define GHOST_MOVES_UNLIMITED UINT8_MAX
+
+// Choose the exit the given ghost (which must be at a junction, outside the
+// ghost home) should take. exits is a bit mask of the directions it can
+// take (bit n for direction n, as for determine_dirns_ghost_can_move_in()
+// in game.c) and normal_choice is the exit it would take normally, which
+// is kept if nothing is any better.
+// The answer depends on the pac-man and on where some of the other ghosts
+// are. *ghosts_read is set to the ghosts (bit n for ghost n) whose every 
+// move could change it. The rest can make *free_moves moves between them
+// without changing it - as long as none of them turns back, or becomes
+// frightened or eaten.
+int8_t ghost_search_direction(uint8_t ghostnum, uint8_t exits, int8_t normal_choice,
+		uint8_t* ghosts_read, uint8_t* free_moves);
+
+// Get the number of searches done, the longest time (in timer 1 counts,
+// i.e. microseconds) one has taken, the most steps one has taken, how many
+// were cut short at MAX_SEARCH_STEPS, and how many of the corridors 
+// followed were already known (hits) or had to be walked cell by cell 
+// (misses)
+void get_ghost_search_stats(uint16_t* searches, uint16_t* max_time,
+		uint16_t* most_steps, uint16_t* cut_short,
+		uint16_t* corridor_hits, uint16_t* corridor_misses);
+
+#endif /* GHOST_SEARCH_H_ */
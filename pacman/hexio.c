@@ -0,0 +1,55 @@
+/*
+ * hexio.c
+ *
+ * Sending and receiving blocks of binary data as hex over the serial port
+ */
+
+#include <stdio.h>
+#include <avr/pgmspace.h>
+
+#include "hexio.h"
+
+// Number of bytes output on each line
+#define HEX_BYTES_PER_LINE 32
+
+void output_hex_byte(uint8_t value, uint16_t index) {
+	if(index % HEX_BYTES_PER_LINE == 0) {
+		printf_P(PSTR("\r\n"));
+	}
+	printf_P(PSTR("%02X"), value);
+}
+
+void end_hex_output(void) {
+	printf_P(PSTR("\r\n.\r\n"));
+}
+
+// Return the value of a hex digit, or -1 if c isn't one
+static int8_t hex_digit_value(char c) {
+	if(c >= '0' && c <= '9') {
+		return c - '0';
+	} else if(c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	} else if(c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+int16_t input_hex_byte(void) {
+	int8_t high = -1;
+	int8_t value;
+	char c;
+
+	while((c = fgetc(stdin)) != '.') {
+		value = hex_digit_value(c);
+		if(value < 0) {
+			continue;
+		}
+		if(high < 0) {
+			high = value;
+		} else {
+			return (high << 4) | value;
+		}
+	}
+	return -1;
+}
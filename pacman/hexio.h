@@ -0,0 +1,24 @@
+/*
+ * hexio.h
+ *
+ * Sending and receiving blocks of binary data over the serial port as 
+ * lines of hex digits (32 bytes to a line) ending with a line containing
+ * a single '.'. This survives being copied to and from a terminal.
+ */
+
+#ifndef HEXIO_H_
+#define HEXIO_H_
+
+#include <stdint.h>
+
+// Output the byte at the given index of the block being sent. Call for
+// each byte in turn (index 0 first) then call end_hex_output().
+void output_hex_byte(uint8_t value, uint16_t index);
+void end_hex_output(void);
+
+// Read the next byte of a block from the serial port, waiting until it
+// arrives. Anything other than hex digits (e.g. line endings) is ignored.
+// Returns -1 when the '.' at the end of the block is reached.
+int16_t input_hex_byte(void);
+
+#endif /* HEXIO_H_ */
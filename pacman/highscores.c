@@ -0,0 +1,160 @@
+/*
+ * highscores.c
+ *
+ * High score table in a wear levelled ring of EEPROM slots - see 
+ * highscores.h
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+#include "highscores.h"
+#include "score.h"
+
+typedef struct {
+	uint16_t sequence;		// One more than the slot written before
+	uint32_t scores[NUM_HIGH_SCORES];
+	uint16_t crc;			// CRC-CCITT of everything before it
+} HighScoreRecord;
+
+// The ring of slots in EEPROM. (An erased slot - all bytes 0xFF - has
+// the wrong CRC.)
+static HighScoreRecord ring[HIGH_SCORE_SLOTS] EEMEM;
+
+static uint32_t table[NUM_HIGH_SCORES];
+
+// The newest slot written (or being written), and its sequence number
+static uint8_t newest_slot;
+static uint16_t newest_sequence;
+
+// The record being written from the interrupt handler, and which byte
+// of it is next. writing is set while it is being written, and 
+// save_needed if the table has changed since it was copied.
+static HighScoreRecord record;
+static volatile uint8_t write_position;
+static volatile uint8_t writing;
+static volatile uint8_t save_needed;
+
+static uint16_t record_crc(const HighScoreRecord* r) {
+	const uint8_t* bytes = (const uint8_t*)r;
+	uint16_t crc = 0xFFFF;
+	for(uint8_t i = 0; i < sizeof(HighScoreRecord) - sizeof(r->crc); i++) {
+		crc = _crc_ccitt_update(crc, bytes[i]);
+	}
+	return crc;
+}
+
+void init_highscores(void) {
+	uint16_t sequence;
+	uint8_t found = 0;
+	
+	// Only the newest slot matters, so only a slot newer than the newest
+	// good one found so far is read in full and checked. (The sequence
+	// numbers are compared as the difference, so they can wrap around.)
+	for(uint8_t slot = 0; slot < HIGH_SCORE_SLOTS; slot++) {
+		sequence = eeprom_read_word(&ring[slot].sequence);
+		if(found && (int16_t)(sequence - newest_sequence) <= 0) {
+			continue;
+		}
+		eeprom_read_block(&record, &ring[slot], sizeof(HighScoreRecord));
+		if(record.crc == record_crc(&record)) {
+			found = 1;
+			newest_slot = slot;
+			newest_sequence = sequence;
+			for(uint8_t i = 0; i < NUM_HIGH_SCORES; i++) {
+				table[i] = record.scores[i];
+			}
+		}
+	}
+	if(!found) {
+		// Start the ring from the first slot
+		newest_slot = HIGH_SCORE_SLOTS - 1;
+		newest_sequence = 0xFFFF;
+		for(uint8_t i = 0; i < NUM_HIGH_SCORES; i++) {
+			table[i] = 0;
+		}
+	}
+	set_highscore(table[0]);
+}
+
+// Copy the table into the next slot's record and start writing it. 
+// (Called with interrupts off, or from the interrupt handler.)
+static void start_writing(void) {
+	newest_slot = (newest_slot + 1) % HIGH_SCORE_SLOTS;
+	record.sequence = ++newest_sequence;
+	for(uint8_t i = 0; i < NUM_HIGH_SCORES; i++) {
+		record.scores[i] = table[i];
+	}
+	record.crc = record_crc(&record);
+	write_position = 0;
+	writing = 1;
+	// The interrupt comes whenever the EEPROM isn't busy
+	EECR |= (1<<EERIE);
+}
+
+int8_t add_highscore(uint32_t value) {
+	int8_t place;
+	uint8_t interrupts_on;
+	
+	// Find where it goes (after any equal scores)
+	for(place = 0; place < NUM_HIGH_SCORES && table[place] >= value; place++) {
+		;
+	}
+	if(value == 0 || place == NUM_HIGH_SCORES) {
+		return -1;
+	}
+	interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	for(int8_t i = NUM_HIGH_SCORES - 1; i > place; i--) {
+		table[i] = table[i - 1];
+	}
+	table[place] = value;
+	if(writing) {
+		// Write it again once this write has finished
+		save_needed = 1;
+	} else {
+		start_writing();
+	}
+	if(interrupts_on) {
+		sei();
+	}
+	return place;
+}
+
+uint32_t get_highscore_entry(uint8_t place) {
+	return (place < NUM_HIGH_SCORES ? table[place] : 0);
+}
+
+uint8_t is_saving_highscores(void) {
+	return writing;
+}
+
+// The EEPROM is ready for the next byte to be written
+ISR(EE_READY_vect) {
+	uint8_t byte;
+	uint16_t address = (uint16_t)&ring[newest_slot];
+	while(write_position < sizeof(HighScoreRecord)) {
+		byte = ((const uint8_t*)&record)[write_position];
+		EEAR = address + write_position++;
+		// Read what's there, and only write it if it's different
+		EECR |= (1<<EERE);
+		if(EEDR != byte) {
+			EEDR = byte;
+			// (The write must be started within 4 clock cycles of
+			// enabling it)
+			EECR |= (1<<EEMPE);
+			EECR |= (1<<EEPE);
+			return;
+		}
+	}
+	if(save_needed) {
+		// The table changed while we were writing - write it again 
+		save_needed = 0;
+		start_writing();
+	} else {
+		EECR &= ~(1<<EERIE);
+		writing = 0;
+	}
+}
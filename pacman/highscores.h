@@ -0,0 +1,43 @@
+/*
+ * highscores.h
+ *
+ * The high score table, kept in EEPROM so it survives a reset. 
+ *
+ * EEPROM cells wear out after about 100,000 writes, so rather than 
+ * writing the table to the same place every time, it is written to the
+ * next of HIGH_SCORE_SLOTS slots in turn (a ring), with a sequence 
+ * number and a CRC. The newest slot with a good CRC is the table - so if
+ * the power goes part way through writing a slot, the slot before is
+ * still there. Writing a byte of EEPROM takes about 3.4ms, so the slot 
+ * is written from the EEPROM ready interrupt, a byte at a time, while 
+ * the game goes on. (Bytes which already hold the right value aren't
+ * written again.)
+ */
+
+#ifndef HIGHSCORES_H_
+#define HIGHSCORES_H_
+
+#include <stdint.h>
+
+// Number of scores in the table, and of slots in the ring (each is 
+// 4 * NUM_HIGH_SCORES + 4 bytes of EEPROM)
+#define NUM_HIGH_SCORES 3
+#define HIGH_SCORE_SLOTS 32
+
+// Read the table from EEPROM (the newest slot with a good CRC - or an 
+// empty table if there isn't one) and set the high score (see score.h)
+// to the top score
+void init_highscores(void);
+
+// Put a final score in the table, if it's high enough, and start writing
+// the table to EEPROM in the background. Returns its place in the table
+// (0 for the top), or -1 if it didn't get in.
+int8_t add_highscore(uint32_t value);
+
+// Return the score at the given place in the table (0 if there isn't one)
+uint32_t get_highscore_entry(uint8_t place);
+
+// Returns 1 while the table is being written to EEPROM
+uint8_t is_saving_highscores(void);
+
+#endif /* HIGHSCORES_H_ */
@@ -0,0 +1,424 @@
+/*
+ * input_log.c
+ *
+ * Recording and replay of game input - see input_log.h for the format of
+ * the log.
+ */
+
+#include "input_log.h"
+#include "levels.h"
+#include "game.h"
+#include "hexio.h"
+#include "scratch.h"
+
+// Game states are saved into the scratch RAM to be logged or checked
+#if GAME_STATE_SIZE > SCRATCH_SIZE
+#error "The game state doesn't fit in the scratch RAM"
+#endif
+
+// Number of ticks that fit in the first byte of a record. A value of
+// SHORT_DELTA_LIMIT means more follow.
+#define SHORT_DELTA_LIMIT 31
+
+// Longest record header: the first byte plus the 7 bit groups of a 32 bit
+// delta
+#define MAX_HEADER_SIZE 6
+
+// Returned by read_header() and next_record() for a record that doesn't
+// fit in the log (it runs past the end, or its delta is longer than
+// MAX_HEADER_SIZE allows). Only an uploaded log can have one.
+#define BAD_RECORD 0xFFFF
+
+// Room kept in the log for input recorded between keyframe checks. Once
+// there is less than this free, a keyframe is recorded rather than let
+// the only record a replay can start from be thrown away.
+#define KEYFRAME_RESERVE (2 * MAX_HEADER_SIZE)
+
+// The log - log_length bytes starting at log_buffer[log_start] (wrapping
+// round to the start of the buffer)
+static uint8_t log_buffer[INPUT_LOG_SIZE];
+static uint16_t log_start;
+static uint16_t log_length;
+
+// Tick of the last record written (ticks restart at 0 with a new game)
+static uint32_t last_record_tick;
+
+// Replay state. replay_position is the offset in the log (from log_start)
+// of the next record to be replayed and replay_tick is the tick of the last
+// record replayed. If replay_first is set then the record at replay_position
+// is due immediately, whatever its delta.
+static uint8_t replaying;
+static uint8_t replay_first;
+static uint16_t replay_position;
+static uint32_t replay_tick;
+static uint16_t replay_random_state;
+static uint8_t replay_ghost_difficulty;
+static uint16_t replay_mismatches;
+
+// Return the byte at the given offset in the log
+static uint8_t log_byte(uint16_t offset) {
+	return log_buffer[(log_start + offset) % INPUT_LOG_SIZE];
+}
+
+// Number of bytes that follow the header of a record of the given type
+static uint16_t payload_length(uint8_t type) {
+	if(type == INPUT_LOG_NEW_GAME) {
+		return 3;
+	} else if(type == INPUT_LOG_KEYFRAME || type == INPUT_LOG_RESTORE) {
+		return GAME_STATE_SIZE;
+	}
+	return 0;
+}
+
+// Read the header of the record at the given offset in the log. Returns the
+// offset of the record's payload, or BAD_RECORD if the header or payload
+// runs past the end of the log or the header is too long.
+static uint16_t read_header(uint16_t offset, uint8_t* type, uint32_t* delta) {
+	uint16_t header_end = offset + MAX_HEADER_SIZE;
+	uint8_t byte = log_byte(offset++);
+	uint8_t shift = 0;
+	*type = byte >> 5;
+	*delta = byte & SHORT_DELTA_LIMIT;
+	if(*delta == SHORT_DELTA_LIMIT) {
+		do {
+			if(offset >= log_length || offset == header_end) {
+				return BAD_RECORD;
+			}
+			byte = log_byte(offset++);
+			*delta += (uint32_t)(byte & 0x7F) << shift;
+			shift += 7;
+		} while(byte & 0x80);
+	}
+	if(offset + payload_length(*type) > log_length) {
+		return BAD_RECORD;
+	}
+	return offset;
+}
+
+// Return the offset of the record after the one at the given offset, or
+// BAD_RECORD
+static uint16_t next_record(uint16_t offset) {
+	uint8_t type;
+	uint32_t delta;
+	offset = read_header(offset, &type, &delta);
+	if(offset == BAD_RECORD) {
+		return BAD_RECORD;
+	}
+	return offset + payload_length(type);
+}
+
+// Returns 1 if the log is made up of whole records, 0 if not
+static uint8_t log_is_valid(void) {
+	uint16_t offset = 0;
+	while(offset < log_length) {
+		offset = next_record(offset);
+		if(offset == BAD_RECORD) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Returns 1 if there is a new game, keyframe or restore (a record a replay
+// can start from) after the oldest record in the log, i.e. one that would
+// still be there if the oldest record was thrown away
+static uint8_t has_later_start(void) {
+	uint8_t type;
+	uint32_t delta;
+	uint16_t offset;
+	if(log_length == 0) {
+		return 0;
+	}
+	for(offset = next_record(0); offset < log_length; 
+			offset += payload_length(type)) {
+		offset = read_header(offset, &type, &delta);
+		if(offset == BAD_RECORD) {
+			break;
+		}
+		if(type >= INPUT_LOG_NEW_GAME) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Throw away the oldest record in the log. The record after it is now the
+// first, so its delta no longer means anything - that's fine since replays
+// start from a new game or keyframe, which don't need the previous record.
+static void drop_oldest_record(void) {
+	uint16_t length = next_record(0);
+	if(length == BAD_RECORD) {
+		length = log_length;
+	}
+	log_start = (log_start + length) % INPUT_LOG_SIZE;
+	log_length -= length;
+}
+
+// Append a record to the log, throwing away the oldest records if there
+// isn't room
+static void write_record(uint8_t type, const uint8_t* payload) {
+	uint8_t header[MAX_HEADER_SIZE];
+	uint8_t header_length = 1;
+	uint16_t length;
+	uint32_t tick, delta;
+
+	if(replaying) {
+		return;
+	}
+	tick = get_game_ticks();
+	delta = tick - last_record_tick;
+	if(delta < SHORT_DELTA_LIMIT) {
+		header[0] = (type << 5) | delta;
+	} else {
+		header[0] = (type << 5) | SHORT_DELTA_LIMIT;
+		delta -= SHORT_DELTA_LIMIT;
+		while(delta >= 0x80) {
+			header[header_length++] = (delta & 0x7F) | 0x80;
+			delta >>= 7;
+		}
+		header[header_length++] = delta;
+	}
+
+	length = header_length + payload_length(type);
+	while(INPUT_LOG_SIZE - log_length < length) {
+		drop_oldest_record();
+	}
+	for(uint8_t i = 0; i < header_length; i++) {
+		log_buffer[(log_start + log_length++) % INPUT_LOG_SIZE] = header[i];
+	}
+	for(uint16_t i = 0; i < payload_length(type); i++) {
+		log_buffer[(log_start + log_length++) % INPUT_LOG_SIZE] = payload[i];
+	}
+	last_record_tick = (type == INPUT_LOG_NEW_GAME) ? 0 : tick;
+}
+
+// Restore the game state from the keyframe or restore record whose payload
+// is at the given offset, and replay on from just after it. Returns 1 if
+// successful, 0 (with nothing changed) if the game state is no good - only
+// possible in an uploaded log.
+static int8_t replay_from_game_state(uint16_t payload) {
+	for(uint16_t i = 0; i < GAME_STATE_SIZE; i++) {
+		scratch.bytes[i] = log_byte(payload + i);
+	}
+	if(!restore_game_state(scratch.bytes)) {
+		return 0;
+	}
+	replay_tick = get_game_ticks();
+	replay_position = payload + GAME_STATE_SIZE;
+	return 1;
+}
+
+void clear_input_log(void) {
+	log_start = 0;
+	log_length = 0;
+	replaying = 0;
+}
+
+void log_direction_change(int8_t direction) {
+	write_record(direction, 0);
+}
+
+void log_pause(void) {
+	write_record(INPUT_LOG_PAUSE, 0);
+}
+
+void log_new_game(uint16_t random_state, uint8_t ghost_difficulty) {
+	uint8_t payload[3];
+	payload[0] = random_state;
+	payload[1] = random_state >> 8;
+	payload[2] = ghost_difficulty;
+	write_record(INPUT_LOG_NEW_GAME, payload);
+}
+
+void log_keyframe_if_due(void) {
+	uint8_t due = 0;
+
+	if(replaying) {
+		return;
+	}
+#if KEYFRAME_INTERVAL
+	due = (get_game_ticks() != 0 && get_game_ticks() % KEYFRAME_INTERVAL == 0);
+#endif
+	if(!due) {
+		if(INPUT_LOG_SIZE - log_length >= KEYFRAME_RESERVE || has_later_start()) {
+			return;
+		}
+		// The log's only starting point is about to go, and with it 
+		// everything that could be replayed - start again from here
+		log_start = 0;
+		log_length = 0;
+	}
+	save_game_state(scratch.bytes);
+	write_record(INPUT_LOG_KEYFRAME, scratch.bytes);
+}
+
+int8_t log_restore_game_state(const uint8_t* state) {
+	if(!is_valid_game_state(state)) {
+		return 0;
+	}
+	stop_replay();
+	// The record's delta is from the ticks before the restore...
+	write_record(INPUT_LOG_RESTORE, state);
+	restore_game_state(state);
+	// ...but the next record's is from the restored ticks
+	last_record_tick = get_game_ticks();
+	return 1;
+}
+
+void send_input_log(void) {
+	for(uint16_t i = 0; i < log_length; i++) {
+		output_hex_byte(log_byte(i), i);
+	}
+	end_hex_output();
+}
+
+uint16_t receive_input_log(void) {
+	int16_t value;
+	uint8_t too_long = 0;
+
+	clear_input_log();
+	while((value = input_hex_byte()) >= 0) {
+		if(log_length < INPUT_LOG_SIZE) {
+			log_buffer[log_length++] = value;
+		} else {
+			too_long = 1;
+		}
+	}
+	if(too_long || !log_is_valid()) {
+		clear_input_log();
+	}
+	return log_length;
+}
+
+int8_t start_replay(void) {
+	uint8_t type;
+	uint32_t delta;
+	uint16_t payload;
+
+	replay_position = 0;
+	replay_mismatches = 0;
+	if(!log_is_valid()) {
+		return 0;
+	}
+	while(replay_position < log_length) {
+		payload = read_header(replay_position, &type, &delta);
+		if(type == INPUT_LOG_NEW_GAME) {
+			// next_replay_input() returns this straight away
+			replaying = 1;
+			replay_first = 1;
+			return 1;
+		} else if(type == INPUT_LOG_KEYFRAME || type == INPUT_LOG_RESTORE) {
+			if(!replay_from_game_state(payload)) {
+				return 0;
+			}
+			replaying = 1;
+			replay_first = 0;
+			return 1;
+		}
+		replay_position = next_record(replay_position);
+	}
+	return 0;
+}
+
+void stop_replay(void) {
+	if(replaying) {
+		replaying = 0;
+		log_length = replay_position;
+		last_record_tick = replay_tick;
+	}
+}
+
+int8_t is_replaying(void) {
+	return replaying;
+}
+
+int8_t next_replay_input(void) {
+	uint8_t type;
+	uint32_t delta;
+	uint16_t payload;
+
+	while(replaying) {
+		if(replay_position >= log_length) {
+			// Reached the end of the log - carry on recording from here
+			stop_replay();
+			break;
+		}
+		payload = read_header(replay_position, &type, &delta);
+		if(payload == BAD_RECORD) {
+			// Can't happen (the log was checked when the replay started)
+			// but don't read past the end - stop here
+			stop_replay();
+			break;
+		}
+		if(!replay_first && replay_tick + delta > get_game_ticks()) {
+			// Not due yet
+			break;
+		}
+		replay_first = 0;
+		if(type == INPUT_LOG_RESTORE) {
+			if(!replay_from_game_state(payload)) {
+				// Can't be replayed - carry on recording from here
+				stop_replay();
+			}
+			continue;
+		}
+		replay_position = payload + payload_length(type);
+		if(type == INPUT_LOG_NEW_GAME) {
+			replay_random_state = log_byte(payload) | (log_byte(payload + 1) << 8);
+			replay_ghost_difficulty = log_byte(payload + 2);
+			replay_tick = 0;
+			return INPUT_LOG_NEW_GAME;
+		}
+		replay_tick += delta;
+		if(type == INPUT_LOG_KEYFRAME) {
+			// Check the game is where it was when this was recorded
+			save_game_state(scratch.bytes);
+			for(uint16_t i = 0; i < GAME_STATE_SIZE; i++) {
+				if(scratch.bytes[i] != log_byte(payload + i)) {
+					replay_mismatches++;
+					break;
+				}
+			}
+		} else {
+			return type;
+		}
+	}
+	return NO_REPLAY_INPUT;
+}
+
+uint16_t get_replay_random_state(void) {
+	return replay_random_state;
+}
+
+uint8_t get_replay_ghost_difficulty(void) {
+	return replay_ghost_difficulty;
+}
+
+int8_t skip_to_next_keyframe(void) {
+	uint8_t type;
+	uint32_t delta;
+	uint16_t offset, payload;
+
+	if(!replaying) {
+		return 0;
+	}
+	for(offset = replay_position; offset < log_length;
+			offset = payload + payload_length(type)) {
+		payload = read_header(offset, &type, &delta);
+		if(payload == BAD_RECORD) {
+			break;
+		}
+		if(type == INPUT_LOG_KEYFRAME || type == INPUT_LOG_RESTORE) {
+			if(!replay_from_game_state(payload)) {
+				return 0;
+			}
+			replay_first = 0;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+uint16_t get_replay_mismatches(void) {
+	return replay_mismatches;
+}
@@ -0,0 +1,133 @@
+/*
+ * input_log.h
+ *
+ * Recording and replay of the input to a game. Every direction change that 
+ * is accepted and every command that affects the game (new game, pause) 
+ * is recorded along with the game tick (see get_game_ticks()) at which it
+ * happened. Since the game is deterministic (given the random number state
+ * at the start of the game) feeding the same input back in at the same 
+ * ticks plays the game out again exactly.
+ *
+ * The log is kept in a RAM ring buffer of INPUT_LOG_SIZE bytes - once full,
+ * the oldest records are thrown away. Each record starts with one byte:
+ *	- the top 3 bits are the record type (INPUT_LOG_ values below)
+ *	- the low 5 bits are the number of ticks since the previous record (0 
+ *	  to 30). 31 means the number of ticks is 31 plus the value that follows
+ *	  - 7 bits per byte, least significant first, top bit set if another
+ *	  byte follows.
+ * followed by:
+ *	- INPUT_LOG_NEW_GAME: the random number state (2 bytes, LSB first) and
+ *	  the ghost difficulty (1 byte). Ticks are counted from 0 again after
+ *	  this.
+ *	- INPUT_LOG_KEYFRAME: GAME_STATE_SIZE bytes of game state (see 
+ *	  save_game_state()). Replay can start from (or skip forward to) any
+ *	  keyframe, so a log whose start has been overwritten can still be
+ *	  replayed. A keyframe is recorded when the log is nearly full and the
+ *	  only record a replay could start from is the oldest one (which is 
+ *	  about to be thrown away) - the log is then started again from the
+ *	  keyframe, as nothing older could be replayed anyway. (A keyframe 
+ *	  is about half the log, so two don't fit - recording them any more
+ *	  often would only throw away more of the input.) Keyframes can also
+ *	  be recorded every KEYFRAME_INTERVAL ticks, e.g. for seeking in a 
+ *	  bigger log on the host.
+ *	- INPUT_LOG_RESTORE: GAME_STATE_SIZE bytes of game state that the game
+ *	  was restored to (e.g. from a snapshot). Ticks carry on from the
+ *	  restored game's ticks after this.
+ * A replay starts from the first new game, keyframe or restore in the log.
+ */
+
+#ifndef INPUT_LOG_H_
+#define INPUT_LOG_H_
+
+#include <stdint.h>
+
+// Steered by the autopilot (a direction change about once a second, most
+// records 2 bytes) this holds 27 seconds of play on average - up to 98 
+// seconds from a new game, and up to 56 seconds after a keyframe.
+#ifndef INPUT_LOG_SIZE
+#define INPUT_LOG_SIZE 192
+#endif
+
+// Number of ticks (ms of game time) between keyframes, or 0 for keyframes
+// only when the log needs one
+#ifndef KEYFRAME_INTERVAL
+#define KEYFRAME_INTERVAL 0
+#endif
+
+// Record types. Direction changes use the direction value (DIRN_LEFT etc.)
+#define INPUT_LOG_PAUSE 4
+#define INPUT_LOG_NEW_GAME 5
+#define INPUT_LOG_KEYFRAME 6
+#define INPUT_LOG_RESTORE 7
+
+// Value returned by next_replay_input() when there is no input due
+#define NO_REPLAY_INPUT -1
+
+// Throw away everything in the log
+void clear_input_log(void);
+
+// Record input. The tick is the current get_game_ticks(). Nothing is
+// recorded while a replay is running.
+void log_direction_change(int8_t direction);
+void log_pause(void);
+void log_new_game(uint16_t random_state, uint8_t ghost_difficulty);
+
+// Record a keyframe if one is due (call after each advance_game_time(), 
+// so keyframes are only taken between ticks)
+void log_keyframe_if_due(void);
+
+// Restore the game state (see restore_game_state()) and record that this
+// was done, so that a replay does the same. Any replay is stopped first.
+// Returns 1 if successful, 0 (with nothing changed or recorded) if the
+// game state is rejected by is_valid_game_state().
+int8_t log_restore_game_state(const uint8_t* state);
+
+// Output the log over the serial port in hex (see hexio.h)
+void send_input_log(void);
+
+// Replace the log with one read from the serial port in the same format
+// as send_input_log() outputs. Returns the number of bytes read, or 0 
+// (leaving the log empty) if they don't fit in the log or aren't all 
+// whole records.
+uint16_t receive_input_log(void);
+
+// Start replaying the log from the first new game, keyframe or restore in
+// it. If this is a keyframe or restore then the game state is restored 
+// from it. Returns 1 if the replay has started, 0 if there is nothing in 
+// the log to replay, it isn't all whole records or the game state is
+// rejected by is_valid_game_state().
+// If the replay starts with a new game then the first next_replay_input()
+// returns INPUT_LOG_NEW_GAME.
+int8_t start_replay(void);
+
+// Stop replaying. Anything in the log not yet replayed is thrown away and
+// recording carries on from here.
+void stop_replay(void);
+
+// Returns 1 if a replay is running, 0 otherwise
+int8_t is_replaying(void);
+
+// Return the next replayed input that is due at the current game tick (a
+// direction value or INPUT_LOG_PAUSE or INPUT_LOG_NEW_GAME), or 
+// NO_REPLAY_INPUT if there isn't one. Call repeatedly (until it returns 
+// NO_REPLAY_INPUT) before each advance_game_time(). Keyframes are checked 
+// against the game state as they are reached and recorded restores are 
+// repeated. The replay stops when the end
+// of the log, or a recorded restore that is rejected, is reached.
+int8_t next_replay_input(void);
+
+// Return the random number state and ghost difficulty recorded with the
+// last INPUT_LOG_NEW_GAME returned by next_replay_input()
+uint16_t get_replay_random_state(void);
+uint8_t get_replay_ghost_difficulty(void);
+
+// Skip forward to the next keyframe (or restore) in the log if there is one,
+// restoring the game state from it. Returns 1 if successful, 0 if there are no more
+// keyframes (or the next one's game state is rejected).
+int8_t skip_to_next_keyframe(void);
+
+// Number of keyframes reached in the replay so far which didn't match the
+// game state (i.e. the replay has gone wrong)
+uint16_t get_replay_mismatches(void);
+
+#endif /* INPUT_LOG_H_ */
@@ -7,6 +7,7 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/sleep.h>
 
 #include "joystick.h"
 #include "timer0.h"
@@ -18,32 +19,65 @@ static uint32_t prev_time;
 void initialise_joystick(void){
 	//Setup ADC
 	ADMUX = (1 <<REFS0); 
-	ADCSRA= (1<<ADEN) | (1<<ADPS2) | (1<<ADPS1) ; 
+	// (with an interrupt at the end of each conversion, to wake us up)
+	ADCSRA= (1<<ADEN) | (1<<ADIE) | (1<<ADPS2) | (1<<ADPS1) ; 
 
 }
-static void get_ADCval(void){
-	//x axis 
-	ADMUX &= ~1; 
-	//convert ADC 
+
+// Nothing to do at the end of a conversion except wake up
+EMPTY_INTERRUPT(ADC_vect);
+
+// Convert the ADC input already selected and return the value. A 
+// conversion takes about 100us, so we sleep (in idle mode) until the ADC
+// interrupt rather than spinning - unless interrupts are off, when nothing
+// would wake us up. Other interrupts (e.g. the timer 0 tick) may wake us
+// up first, so we check and go back to sleep until it's done.
+static uint16_t convert_ADC(void){
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
 	ADCSRA |= (1<<ADSC) ; 
+	if(interrupts_on){
+		set_sleep_mode(SLEEP_MODE_IDLE);
+		cli();
+		while(ADCSRA & (1<<ADSC)){
+			sleep_enable();
+			sei();		// (the sleep is done before any interrupt)
+			sleep_cpu();
+			sleep_disable();
+			cli();
+		}
+		sei();
+	}
 	while(ADCSRA & (1<<ADSC)){
 		; //wait conversion. 
 	}
-	adc_x = ADC;  //read value 
+	return ADC; 
+}
+
+static void get_ADCval(void){
+	//x axis 
+	ADMUX &= ~1; 
+	adc_x = convert_ADC();  //read value 
 	
 	//read y axis 
 	ADMUX |= 1; 
-	ADCSRA |= (1<<ADSC); 
-	while (ADCSRA & (1<<ADSC)){
-		; //wait
+	adc_y = convert_ADC();  //read value 
+}
+
+uint16_t joystick_noise(void){
+	// The least significant bit of each reading changes at random (noise)
+	// so collect one bit from each pair of readings 
+	uint16_t noise = 0; 
+	for(uint8_t i = 0; i < 16; i++){
+		get_ADCval(); 
+		noise = (noise << 1) | ((adc_x ^ adc_y) & 1); 
 	}
-	adc_y = ADC;  //read value 
+	return noise; 
 }
 
 uint8_t joystick_dir(void){
 	// 1=up , 2=down , 3= left, 4= right, -1= middle 
 	uint8_t direction; 
-	uint8_t current_time; 
+	uint32_t current_time; 
 	get_ADCval(); 
 	if (adc_x >768) {
 		direction = 4 ; 
@@ -70,12 +104,13 @@ uint8_t joystick_dir(void){
 	}
 	if (direction >0){
 		if(prev_dir == direction){
-			current_time = get_current_time(); 
-			if (current_time < prev_time + 300){
+			// (The wall clock, so a pause doesn't hold up the repeat)
+			current_time = get_wall_time(); 
+			if (current_time - prev_time < 300){
 				return -1 ; 
 			}
 		}
-		prev_time = get_current_time() ; 
+		prev_time = get_wall_time() ; 
 		prev_dir = direction ; 
 	}
 	return direction ; 
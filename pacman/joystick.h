@@ -17,6 +17,9 @@ void initialise_joystic(void);
 //Current joystick direction 
 uint8_t joystick_dir(void); 
 
+//16 bits of noise from the ADC readings - for seeding random numbers 
+uint16_t joystick_noise(void); 
+
 
 
 
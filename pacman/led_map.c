@@ -0,0 +1,160 @@
+/*
+ * led_map.c
+ *
+ * LED matrix view of the game - see led_map.h
+ */
+
+#include <avr/pgmspace.h>
+
+#include "led_map.h"
+#include "ledmatrix.h"
+#include "scrolling_char_display.h"
+
+#if FIELD_WIDTH < MATRIX_NUM_COLUMNS || FIELD_HEIGHT < MATRIX_NUM_ROWS
+#error "The game field must be at least as big as the LED matrix"
+#endif
+
+// Colours used. The LED matrix only has red and green, so the ghosts can
+// only be something like their terminal colours (red, green, cyan and
+// magenta - see game_display.c), and frightened ghosts are dim rather
+// than blue.
+static const PixelColour ghost_map_colours[NUM_GHOSTS] PROGMEM = {
+	COLOUR_RED, COLOUR_GREEN, COLOUR_LIGHT_YELLOW, COLOUR_ORANGE
+};
+#define MAP_PACMAN_COLOUR COLOUR_YELLOW
+#define MAP_FRIGHTENED_GHOST_COLOUR COLOUR_LIGHT_GREEN
+#define MAP_PACDOT_COLOUR 0x01
+#define MAP_PELLET_COLOUR COLOUR_LIGHT_ORANGE
+#define MAP_WALL_COLOUR 0x20
+
+// The view is moved when the pac-man gets closer than this to its edge
+#define MAP_MARGIN_X 4
+#define MAP_MARGIN_Y 2
+
+// Furthest right and down the view can go
+#define MAX_VIEW_X (FIELD_WIDTH - MATRIX_NUM_COLUMNS)
+#define MAX_VIEW_Y (FIELD_HEIGHT - MATRIX_NUM_ROWS)
+
+// The cell shown at the top left of the matrix
+static uint8_t view_x;
+static uint8_t view_y;
+
+// Work out the colour to show for cell (x,y) of the game field
+static PixelColour cell_colour(uint8_t x, uint8_t y) {
+	if(get_pacman_x() == x && get_pacman_y() == y) {
+		return MAP_PACMAN_COLOUR;
+	}
+	for(int8_t i = 0; i < NUM_GHOSTS; i++) {
+		if(get_ghost_x(i) == x && get_ghost_y(i) == y) {
+			if(is_ghost_frightened(i)) {
+				return MAP_FRIGHTENED_GHOST_COLOUR;
+			}
+			return pgm_read_byte(&ghost_map_colours[i]);
+		}
+	}
+	if(is_pacdot_at(x, y)) {
+		return MAP_PACDOT_COLOUR;
+	} else if(is_pellet_at(x, y)) {
+		return MAP_PELLET_COLOUR;
+	} else if(is_wall_at(x, y)) {
+		return MAP_WALL_COLOUR;
+	}
+	return COLOUR_BLACK;
+}
+
+// Draw cell (x,y) of the game field, if it is in view. (Field y goes down
+// the terminal but matrix y goes up the matrix.)
+static void draw_map_cell(uint8_t x, uint8_t y) {
+	if(x >= view_x && x < view_x + MATRIX_NUM_COLUMNS && 
+			y >= view_y && y < view_y + MATRIX_NUM_ROWS) {
+		ledmatrix_update_pixel(x - view_x, MATRIX_NUM_ROWS - 1 - (y - view_y),
+				cell_colour(x, y));
+	}
+}
+
+static void draw_map_column(uint8_t x) {
+	for(uint8_t y = view_y; y < view_y + MATRIX_NUM_ROWS; y++) {
+		draw_map_cell(x, y);
+	}
+}
+
+static void draw_map_row(uint8_t y) {
+	for(uint8_t x = view_x; x < view_x + MATRIX_NUM_COLUMNS; x++) {
+		draw_map_cell(x, y);
+	}
+}
+
+static void draw_whole_map(void) {
+	for(uint8_t y = view_y; y < view_y + MATRIX_NUM_ROWS; y++) {
+		draw_map_row(y);
+	}
+}
+
+// Return the nearest position for the view (from the given position along
+// one axis) which keeps pos at least margin from its edges
+static uint8_t follow(uint8_t view, uint8_t pos, uint8_t size, uint8_t margin, uint8_t max_view) {
+	if(pos < view + margin) {
+		view = (pos > margin ? pos - margin : 0);
+	} else if(pos >= view + size - margin) {
+		view = pos - (size - margin - 1);
+	}
+	return (view > max_view ? max_view : view);
+}
+
+// Move the view if the pac-man is getting near its edge. A move of one 
+// cell (the pac-man having moved one cell) is done by shifting what is 
+// already shown and drawing the cells coming into view.
+static void follow_pacman(void) {
+	uint8_t new_view_x = follow(view_x, get_pacman_x(), MATRIX_NUM_COLUMNS, MAP_MARGIN_X, MAX_VIEW_X);
+	uint8_t new_view_y = follow(view_y, get_pacman_y(), MATRIX_NUM_ROWS, MAP_MARGIN_Y, MAX_VIEW_Y);
+	if(new_view_x == view_x && new_view_y == view_y) {
+		return;
+	}
+	if(new_view_y == view_y && new_view_x == view_x + 1) {
+		view_x = new_view_x;
+		ledmatrix_shift_display_left();
+		draw_map_column(view_x + MATRIX_NUM_COLUMNS - 1);
+	} else if(new_view_y == view_y && new_view_x + 1 == view_x) {
+		view_x = new_view_x;
+		ledmatrix_shift_display_right();
+		draw_map_column(view_x);
+	} else if(new_view_x == view_x && new_view_y == view_y + 1) {
+		view_y = new_view_y;
+		ledmatrix_shift_display_up();
+		draw_map_row(view_y + MATRIX_NUM_ROWS - 1);
+	} else if(new_view_x == view_x && new_view_y + 1 == view_y) {
+		view_y = new_view_y;
+		ledmatrix_shift_display_down();
+		draw_map_row(view_y);
+	} else {
+		// Jumped (e.g. through a tunnel)
+		view_x = new_view_x;
+		view_y = new_view_y;
+		draw_whole_map();
+	}
+}
+
+void show_map(void) {
+	// Start with the pac-man in the middle of the view
+	view_x = follow(0, get_pacman_x(), MATRIX_NUM_COLUMNS, MATRIX_NUM_COLUMNS / 2, MAX_VIEW_X);
+	view_y = follow(0, get_pacman_y(), MATRIX_NUM_ROWS, MATRIX_NUM_ROWS / 2, MAX_VIEW_Y);
+	draw_whole_map();
+}
+
+void show_game_event_on_map(const GameEvent* event) {
+	if(is_text_scrolling()) {
+		// The map is drawn again once the text has gone
+		return;
+	}
+	switch(event->type) {
+		case GAME_EVENT_CELL_CHANGED:
+		case GAME_EVENT_LIFE_LOST:
+		case GAME_EVENT_GHOST_EATEN:
+			follow_pacman();
+			draw_map_cell(event->x, event->y);
+			break;
+		case GAME_EVENT_REDRAW:
+			show_map();
+			break;
+	}
+}
@@ -0,0 +1,26 @@
+/*
+ * led_map.h
+ *
+ * Shows the part of the game field around the pac-man on the LED matrix,
+ * one pixel per cell: the pac-man in yellow, the ghosts in colours like
+ * those they have on the terminal, and the pac-dots, power pellets and
+ * walls dimmed. The view moves with the pac-man once it gets near the
+ * edge. Only what an event says has changed is drawn (and the LED matrix
+ * only sends pixels which have actually changed - see ledmatrix.h).
+ * Nothing is drawn while text is scrolling across the matrix (see 
+ * scrolling_char_display.h) - show_map() should be called once it's gone.
+ */
+
+#ifndef LED_MAP_H_
+#define LED_MAP_H_
+
+#include "game.h"
+
+// Draw the whole map, with the pac-man in the middle of the view (unless
+// it's near the edge of the field)
+void show_map(void);
+
+// Draw what the given event (taken from get_game_event()) says has changed
+void show_game_event_on_map(const GameEvent* event);
+
+#endif /* LED_MAP_H_ */
@@ -7,6 +7,8 @@
  */ 
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include "ledmatrix.h"
 #include "spi.h"
 
@@ -17,20 +19,300 @@
 #define CMD_SHIFT_DISPLAY 0x04
 #define CMD_CLEAR_SCREEN 0x0F
 
+// Number of bytes each command takes
+#define ALL_COST (1 + MATRIX_NUM_COLUMNS * MATRIX_NUM_ROWS)
+#define PIXEL_COST 3
+#define ROW_COST (2 + MATRIX_NUM_COLUMNS)
+#define COLUMN_COST (2 + MATRIX_NUM_ROWS)
+#define SHIFT_COST 2
+
+// Direction bytes for CMD_SHIFT_DISPLAY
+#define SHIFT_RIGHT 0x01
+#define SHIFT_LEFT 0x02
+#define SHIFT_DOWN 0x04
+#define SHIFT_UP 0x08
+
+// The functions below don't talk to the LED matrix themselves. They change
+// what should be shown in frame (a memory write) and mark the pixels which
+// have changed as dirty - bit x of dirty_rows[y] and bit y of 
+// dirty_columns[x] for pixel (x,y). The changes are sent from the SPI 
+// interrupt handler, one command after another, in the background. Each
+// command is chosen to send the dirty pixels in as few bytes as possible
+// (see next_command()), and its data is copied into command_buffer when
+// it is started, so the frame can be changed while it is being sent - i.e.
+// the frame is the back buffer and the matrix's own display (together with
+// the dirty pixels still to be sent) is the front buffer. (A second full
+// copy of the frame would take another 128 bytes of RAM.)
+static MatrixData frame;
+static volatile uint16_t dirty_rows[MATRIX_NUM_ROWS];
+static volatile uint8_t dirty_columns[MATRIX_NUM_COLUMNS];
+
+// Set when the matrix is to be cleared (before anything else is sent)
+static volatile uint8_t clear_needed;
+
+// Shifts to be sent (directions, oldest first), before any dirty pixels.
+// The dirty pixels are where they will be after these shifts.
+#define MAX_PENDING_SHIFTS 4
+static volatile uint8_t pending_shifts[MAX_PENDING_SHIFTS];
+static volatile uint8_t num_pending_shifts;
+
+// The command being sent - command_length bytes, of which the next to be
+// sent is command_buffer[command_position]. sending is set while the SPI
+// interrupt handler is sending commands. A CMD_UPDATE_ALL command is too
+// long for the buffer, so its pixels are sent straight from the frame and
+// sending_all is set. (Pixels changed after it started are dirty, so are
+// sent again afterwards even if they were sent with their new colour.)
+static uint8_t command_buffer[2 + MATRIX_NUM_COLUMNS];
+static volatile uint8_t command_length;
+static volatile uint8_t command_position;
+static volatile uint8_t sending;
+static volatile uint8_t sending_all;
+
+// Bytes sent since the LED matrix was last up to date, and stats about the
+// frames sent (a frame being everything sent from the first change to the
+// matrix being up to date again)
+static uint16_t frame_bytes;
+static uint16_t last_frame_bytes;
+static uint16_t max_frame_bytes;
+static uint32_t frames_sent;
+static uint32_t bytes_sent;
+
+// Number of bits set in each value from 0 to 15
+static const uint8_t bits_in_nibble[16] PROGMEM = {
+	0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+
+static uint8_t count_bits(uint8_t bits) {
+	return pgm_read_byte(&bits_in_nibble[bits & 0x0F]) + 
+			pgm_read_byte(&bits_in_nibble[bits >> 4]);
+}
+
+// Count the dirty pixels in each row and column (given which are dirty in
+// each row and in each column)
+static void count_dirty_pixels(const volatile uint16_t* rows, const volatile uint8_t* columns,
+		uint8_t* row_counts, uint8_t* column_counts) {
+	for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+		row_counts[y] = count_bits(rows[y] & 0xFF) + count_bits(rows[y] >> 8);
+	}
+	for(uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+		column_counts[x] = count_bits(columns[x]);
+	}
+}
+
+// Work out roughly how many bytes it would take to send the dirty pixels
+// (given how many there are in each row and column): the cheaper of 
+// sending each row either whole or pixel by pixel, sending each column 
+// either whole or pixel by pixel, and sending everything.
+static uint8_t cost_to_send(const uint8_t* row_counts, const uint8_t* column_counts) {
+	uint16_t by_rows = 0;
+	uint16_t by_columns = 0;
+	for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+		by_rows += (row_counts[y] * PIXEL_COST < ROW_COST ? row_counts[y] * PIXEL_COST : ROW_COST);
+	}
+	for(uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+		by_columns += (column_counts[x] * PIXEL_COST < COLUMN_COST ? column_counts[x] * PIXEL_COST : COLUMN_COST);
+	}
+	if(by_columns < by_rows) {
+		by_rows = by_columns;
+	}
+	return (by_rows < ALL_COST ? by_rows : ALL_COST);
+}
+
 void ledmatrix_setup(void) {
 	// Setup SPI - we divide the clock by 128.
 	// (This speed guarantees the SPI buffer will never overflow on
-	// the LED matrix.)
+	// the LED matrix. Each byte takes 128us, and the next is only sent
+	// from the interrupt at the end of the last, so the same holds.)
 	spi_setup_master(128);
+	SPCR0 |= (1<<SPIE0);
+	ledmatrix_clear();
+}
+
+// Put the next command to be sent in command_buffer. Returns 0 if 
+// there's nothing left to send. Called with interrupts off.
+//
+// Commands are chosen one at a time, greedily: a clear or shift if one is
+// waiting, everything if that's cheaper than sending the dirty pixels any
+// other way, otherwise whichever row or column saves the most bytes over
+// sending its dirty pixels one by one, or if none would, a single pixel.
+// (The best choice can change as pixels are changed while this command is
+// being sent, so there's no point planning further ahead.)
+static uint8_t next_command(void) {
+	uint8_t row_counts[MATRIX_NUM_ROWS];
+	uint8_t column_counts[MATRIX_NUM_COLUMNS];
+	uint8_t y, x, best_y, best_x;
+	int8_t row_saving, column_saving;
+	uint16_t bits;
+	
+	sending_all = 0;
+	if(clear_needed) {
+		clear_needed = 0;
+		command_buffer[0] = CMD_CLEAR_SCREEN;
+		command_length = 1;
+		return 1;
+	}
+	if(num_pending_shifts) {
+		command_buffer[0] = CMD_SHIFT_DISPLAY;
+		command_buffer[1] = pending_shifts[0];
+		num_pending_shifts--;
+		for(uint8_t i = 0; i < num_pending_shifts; i++) {
+			pending_shifts[i] = pending_shifts[i + 1];
+		}
+		command_length = SHIFT_COST;
+		return 1;
+	}
+	
+	count_dirty_pixels(dirty_rows, dirty_columns, row_counts, column_counts);
+	best_y = 0;
+	for(y = 1; y < MATRIX_NUM_ROWS; y++) {
+		if(row_counts[y] > row_counts[best_y]) {
+			best_y = y;
+		}
+	}
+	if(row_counts[best_y] == 0) {
+		// Nothing is dirty
+		return 0;
+	}
+	if(cost_to_send(row_counts, column_counts) == ALL_COST) {
+		for(y = 0; y < MATRIX_NUM_ROWS; y++) {
+			dirty_rows[y] = 0;
+		}
+		for(x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+			dirty_columns[x] = 0;
+		}
+		command_buffer[0] = CMD_UPDATE_ALL;
+		command_length = ALL_COST;
+		sending_all = 1;
+		return 1;
+	}
+	best_x = 0;
+	for(x = 1; x < MATRIX_NUM_COLUMNS; x++) {
+		if(column_counts[x] > column_counts[best_x]) {
+			best_x = x;
+		}
+	}
+	row_saving = row_counts[best_y] * PIXEL_COST - ROW_COST;
+	column_saving = column_counts[best_x] * PIXEL_COST - COLUMN_COST;
+	
+	if(row_saving > 0 && row_saving >= column_saving) {
+		dirty_rows[best_y] = 0;
+		command_buffer[0] = CMD_UPDATE_ROW;
+		command_buffer[1] = best_y;
+		for(x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+			dirty_columns[x] &= ~(1 << best_y);
+			command_buffer[2 + x] = frame[x][best_y];
+		}
+		command_length = ROW_COST;
+	} else if(column_saving > 0) {
+		dirty_columns[best_x] = 0;
+		command_buffer[0] = CMD_UPDATE_COL;
+		command_buffer[1] = best_x;
+		for(y = 0; y < MATRIX_NUM_ROWS; y++) {
+			dirty_rows[y] &= ~(1U << best_x);
+			command_buffer[2 + y] = frame[best_x][y];
+		}
+		command_length = COLUMN_COST;
+	} else {
+		// The first dirty pixel in the row with the most
+		bits = dirty_rows[best_y];
+		for(x = 0; !(bits & 1); x++) {
+			bits >>= 1;
+		}
+		dirty_rows[best_y] &= ~(1U << x);
+		dirty_columns[x] &= ~(1 << best_y);
+		command_buffer[0] = CMD_UPDATE_PIXEL;
+		command_buffer[1] = (best_y << 4) | x;
+		command_buffer[2] = frame[x][best_y];
+		command_length = PIXEL_COST;
+	}
+	return 1;
+}
+
+// Start sending the next command (if there is one), with interrupts off.
+static void send_next_command(void) {
+	if(next_command()) {
+		sending = 1;
+		command_position = 1;
+		frame_bytes += command_length;
+		bytes_sent += command_length;
+		SPDR0 = command_buffer[0];
+	} else {
+		if(sending) {
+			// The matrix is now up to date
+			frames_sent++;
+			last_frame_bytes = frame_bytes;
+			if(frame_bytes > max_frame_bytes) {
+				max_frame_bytes = frame_bytes;
+			}
+			frame_bytes = 0;
+		}
+		sending = 0;
+	}
+}
+
+// Start sending the changes if they're not already being sent
+static void start_sending(void) {
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	if(!sending) {
+		send_next_command();
+	}
+	if(interrupts_on) {
+		sei();
+	}
+}
+
+// The last byte has been sent - send the next
+ISR(SPI_STC_vect) {
+	uint8_t position;
+	(void)SPDR0;
+	if(command_position < command_length) {
+		position = command_position++;
+		if(sending_all) {
+			// Pixels are sent a row at a time from the bottom
+			position--;
+			SPDR0 = frame[position % MATRIX_NUM_COLUMNS][position / MATRIX_NUM_COLUMNS];
+		} else {
+			SPDR0 = command_buffer[position];
+		}
+	} else {
+		send_next_command();
+	}
+}
+
+uint8_t ledmatrix_is_sending(void) {
+	return sending;
+}
+
+void get_ledmatrix_stats(uint32_t* frames, uint16_t* last_bytes, uint16_t* max_bytes, uint32_t* bytes) {
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	*frames = frames_sent;
+	*last_bytes = last_frame_bytes;
+	*max_bytes = max_frame_bytes;
+	*bytes = bytes_sent;
+	if(interrupts_on) {
+		sei();
+	}
+}
+
+// Change a pixel in the frame, marking it dirty if it has changed. 
+// (x and y must be valid.)
+static void set_pixel(uint8_t x, uint8_t y, PixelColour pixel) {
+	if(frame[x][y] != pixel) {
+		frame[x][y] = pixel;
+		dirty_rows[y] |= (1U << x);
+		dirty_columns[x] |= (1 << y);
+	}
 }
 
 void ledmatrix_update_all(MatrixData data) {
-	(void)spi_send_byte(CMD_UPDATE_ALL);
 	for(uint8_t y=0; y<MATRIX_NUM_ROWS; y++) {
 		for(uint8_t x=0; x<MATRIX_NUM_COLUMNS; x++) {
-			(void)spi_send_byte(data[x][y]);
+			set_pixel(x, y, data[x][y]);
 		}
 	}
+	start_sending();
 }
 
 void ledmatrix_update_pixel(uint8_t x, uint8_t y, PixelColour pixel) {
@@ -38,9 +320,8 @@ void ledmatrix_update_pixel(uint8_t x, uint8_t y, PixelColour pixel) {
 		// Position isn't valid - we ignore the request.
 		return;
 	}
-	(void)spi_send_byte(CMD_UPDATE_PIXEL);
-	(void)spi_send_byte( ((y & 0x07)<<4) | (x & 0x0F));
-	(void)spi_send_byte(pixel);
+	set_pixel(x, y, pixel);
+	start_sending();
 }
 
 void ledmatrix_update_row(uint8_t y, MatrixRow row) {
@@ -48,11 +329,10 @@ void ledmatrix_update_row(uint8_t y, MatrixRow row) {
 		// y value is too large - we ignore the request
 		return;
 	}
-	(void)spi_send_byte(CMD_UPDATE_ROW);
-	(void)spi_send_byte(y & 0x07);	// row number
 	for(uint8_t x = 0; x<MATRIX_NUM_COLUMNS; x++) {
-		(void)spi_send_byte(row[x]);
+		set_pixel(x, y, row[x]);
 	}
+	start_sending();
 }
 
 void ledmatrix_update_column(uint8_t x, MatrixColumn col) {
@@ -60,35 +340,143 @@ void ledmatrix_update_column(uint8_t x, MatrixColumn col) {
 		// x value is too large - we ignore the request
 		return;
 	}
-	(void)spi_send_byte(CMD_UPDATE_COL);
-	(void)spi_send_byte(x & 0x0F); // column number
 	for(uint8_t y = 0; y<MATRIX_NUM_ROWS; y++) {
-		(void)spi_send_byte(col[y]);
+		set_pixel(x, y, col[y]);
+	}
+	start_sending();
+}
+
+// Return the colour pixel (x,y) will be after the frame is moved by dx
+// and dy (one of which is 1 or -1, the other 0). The column or row coming
+// in is blank, as it is when the matrix itself shifts its display.
+static PixelColour shifted_pixel(uint8_t x, uint8_t y, int8_t dx, int8_t dy) {
+	// (These wrap around to 255 if off the left or bottom edge)
+	uint8_t from_x = x - dx;
+	uint8_t from_y = y - dy;
+	if(from_x >= MATRIX_NUM_COLUMNS || from_y >= MATRIX_NUM_ROWS) {
+		return COLOUR_BLACK;
 	}
+	return frame[from_x][from_y];
+}
+
+// Move the frame by dx and dy (one of which is 1 or -1, the other 0). This
+// can be sent either as a shift command (direction is the direction byte)
+// followed by the pixels that were already dirty, or as the pixels that 
+// have changed - whichever is cheaper. E.g. shifting the game map along 
+// with the pac-man then sending the one new column is much cheaper than
+// sending every pixel of the maze that has moved, but shifting a display
+// with only a few pixels lit isn't worth it.
+static void shift_display(int8_t dx, int8_t dy, uint8_t direction) {
+	uint16_t shifted_rows[MATRIX_NUM_ROWS];		// Dirty if shifted
+	uint8_t shifted_columns[MATRIX_NUM_COLUMNS];
+	uint16_t changed_rows[MATRIX_NUM_ROWS];		// Dirty if not shifted
+	uint8_t changed_columns[MATRIX_NUM_COLUMNS];
+	uint8_t row_counts[MATRIX_NUM_ROWS];
+	uint8_t column_counts[MATRIX_NUM_COLUMNS];
+	uint8_t shift_cost, redraw_cost, x, y, interrupts_on;
+	
+	// Work out which pixels will be dirty either way. (The SPI interrupt 
+	// handler can only clear dirty pixels meanwhile, so at worst some are
+	// sent again.)
+	for(y = 0; y < MATRIX_NUM_ROWS; y++) {
+		shifted_rows[y] = ((uint8_t)(y - dy) < MATRIX_NUM_ROWS ? dirty_rows[y - dy] : 0);
+		if(dx > 0) {
+			shifted_rows[y] <<= 1;
+		} else if(dx < 0) {
+			shifted_rows[y] >>= 1;
+		}
+		changed_rows[y] = dirty_rows[y];
+	}
+	for(x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+		shifted_columns[x] = ((uint8_t)(x - dx) < MATRIX_NUM_COLUMNS ? dirty_columns[x - dx] : 0);
+		if(dy > 0) {
+			shifted_columns[x] <<= 1;
+		} else if(dy < 0) {
+			shifted_columns[x] >>= 1;
+		}
+		changed_columns[x] = dirty_columns[x];
+		for(y = 0; y < MATRIX_NUM_ROWS; y++) {
+			if(shifted_pixel(x, y, dx, dy) != frame[x][y]) {
+				changed_rows[y] |= (1U << x);
+				changed_columns[x] |= (1 << y);
+			}
+		}
+	}
+	count_dirty_pixels(shifted_rows, shifted_columns, row_counts, column_counts);
+	shift_cost = SHIFT_COST + cost_to_send(row_counts, column_counts);
+	count_dirty_pixels(changed_rows, changed_columns, row_counts, column_counts);
+	redraw_cost = cost_to_send(row_counts, column_counts);
+	
+	interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	// Move the frame, going against the direction of the shift so each 
+	// pixel is moved before it is overwritten
+	for(uint8_t i = 0; i < MATRIX_NUM_COLUMNS; i++) {
+		x = (dx > 0 ? MATRIX_NUM_COLUMNS - 1 - i : i);
+		for(uint8_t j = 0; j < MATRIX_NUM_ROWS; j++) {
+			y = (dy > 0 ? MATRIX_NUM_ROWS - 1 - j : j);
+			frame[x][y] = shifted_pixel(x, y, dx, dy);
+		}
+	}
+	// (A shift can't be sent while the whole display is being sent from the
+	// frame, as the rest of it would now be sent in the wrong place)
+	if(shift_cost < redraw_cost && !sending_all && num_pending_shifts < MAX_PENDING_SHIFTS) {
+		pending_shifts[num_pending_shifts++] = direction;
+		for(y = 0; y < MATRIX_NUM_ROWS; y++) {
+			dirty_rows[y] = shifted_rows[y];
+		}
+		for(x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+			dirty_columns[x] = shifted_columns[x];
+		}
+	} else {
+		for(y = 0; y < MATRIX_NUM_ROWS; y++) {
+			dirty_rows[y] = changed_rows[y];
+		}
+		for(x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+			dirty_columns[x] = changed_columns[x];
+		}
+	}
+	if(interrupts_on) {
+		sei();
+	}
+	start_sending();
 }
 
 void ledmatrix_shift_display_left(void) {
-	(void)spi_send_byte(CMD_SHIFT_DISPLAY);
-	(void)spi_send_byte(0x02);
+	shift_display(-1, 0, SHIFT_LEFT);
 }
 
 void ledmatrix_shift_display_right(void) {
-	(void)spi_send_byte(CMD_SHIFT_DISPLAY);
-	(void)spi_send_byte(0x01);
+	shift_display(1, 0, SHIFT_RIGHT);
 }
 
 void ledmatrix_shift_display_up(void) {
-	(void)spi_send_byte(CMD_SHIFT_DISPLAY);
-	(void)spi_send_byte(0x08);
+	shift_display(0, 1, SHIFT_UP);
 }
 
 void ledmatrix_shift_display_down(void) {
-	(void)spi_send_byte(CMD_SHIFT_DISPLAY);
-	(void)spi_send_byte(0x04);
+	shift_display(0, -1, SHIFT_DOWN);
 }
 
 void ledmatrix_clear(void) {
-	(void)spi_send_byte(CMD_CLEAR_SCREEN);
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	for(uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+		for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+			frame[x][y] = COLOUR_BLACK;
+		}
+		dirty_columns[x] = 0;
+	}
+	for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+		dirty_rows[y] = 0;
+	}
+	// (Any shifts still to be sent would make no difference)
+	num_pending_shifts = 0;
+	clear_needed = 1;
+	if(interrupts_on) {
+		sei();
+	}
+	start_sending();
 }
 
 void copy_matrix_column(MatrixColumn from, MatrixColumn to) {
@@ -31,6 +31,13 @@ void ledmatrix_setup(void);
 // For those functions which take an x or a y value, the value must be valid
 // or the request will be ignored. (i.e. x must be < MATRIX_NUM_COLUMNS
 // and y must be < MATRIX_NUM_ROWS)
+// These don't wait for anything to be sent to the LED matrix. They change
+// a copy of the display kept in RAM, and the pixels which have changed are 
+// sent in the background (from the SPI interrupt), so they can be called 
+// as often as needed. (Setting a pixel to the colour it already is costs 
+// nothing.) Whatever has changed is sent using whichever commands take
+// the fewest bytes, e.g. a shift followed by the one new column rather 
+// than every pixel that has moved.
 void ledmatrix_update_all(MatrixData data);
 void ledmatrix_update_pixel(uint8_t x, uint8_t y, PixelColour pixel);
 void ledmatrix_update_row(uint8_t y, MatrixRow row);
@@ -41,6 +48,15 @@ void ledmatrix_shift_display_up(void);
 void ledmatrix_shift_display_down(void);
 void ledmatrix_clear(void);
 
+// Returns 1 if changes are still being sent to the LED matrix
+uint8_t ledmatrix_is_sending(void);
+
+// Get the number of frames sent (a frame being all the bytes sent from a
+// change until the LED matrix is up to date again), the number of bytes 
+// in the last frame and the largest frame, and the number of bytes sent
+// altogether
+void get_ledmatrix_stats(uint32_t* frames, uint16_t* last_bytes, uint16_t* max_bytes, uint32_t* bytes);
+
 // Functions to operate on MatrixRow and MatrixColumn data structures
 void copy_matrix_column(MatrixColumn from, MatrixColumn to);
 void copy_matrix_row(MatrixRow from, MatrixRow to);
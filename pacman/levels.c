@@ -0,0 +1,433 @@
+/*
+ * levels.c
+ *
+ * Maze and other per-level data. Everything here lives in program
+ * memory - only the pac-dots that are still to be eaten are kept in
+ * RAM (see game.c).
+ */
+
+#include "levels.h"
+#include "maze.h"
+
+///////////////////////////////////////////////////////////
+// Game fields
+// Each game field is FIELD_HEIGHT rows of FIELD_WIDTH cells - 31x31, or
+// 47x31 for the wide maze below. Each cell is one of the following (shown in the pictures below as):
+// (space) - nothing at this location
+// - - horizontal wall at this location - uses LINE_HORIZONTAL
+// | - vertical wall at this location - uses LINE_VERTICAL
+// F - wall is down and to the right - uses LINE_DOWN_AND_RIGHT
+// 7 - wall is down and to the left - uses LINE_DOWN_AND_LEFT
+// L - wall is up and to the right - uses LINE_UP_AND_RIGHT
+// J - wall is up and to the left - uses LINE_UP_AND_LEFT
+// > - wall is vertical and to the right - uses LINE_VERTICAL_AND_RIGHT
+// < - wall is vertical and to the left - uses LINE_VERTICAL_AND_LEFT
+// ^ - wall is horizontal and up - uses LINE_HORIZONTAL_AND_UP
+// v - wall is horizontal and down - uses LINE_HORIZONTAL_AND_DOWN
+// + - wall is in all directions - uses LINE_VERTICAL_AND_HORIZONTAL
+// . - pacdot initially at this location
+// P - power pellet initial location
+//
+// The fields are stored compressed in program memory (see maze.h for the 
+// format). Each row is a list of runs of identical cells - R(class,length).
+// All the mazes are symmetric so only the left half of each row (up to and
+// including the middle column) is stored. Spaces that can't be reached are
+// stored as FIL (filled) - they look the same but are treated as walls. 
+//
+// Every other cell is walkable and has an index - walkable cells are 
+// numbered from 0 in row order. levelN_cells[y] is the index of the first
+// walkable cell in row y (the last entry is the number of walkable cells,
+// which must be no more than MAX_WALKABLE_CELLS).
+//
+// tools/encode_maze.py generates these arrays from a maze picture.
+
+#define R(cell_class, length) ((CELL_CLASS_##cell_class << 4) | ((length) - 1))
+#define CELL_CLASS_SP CELL_CLASS_SPACE
+#define CELL_CLASS_DOT CELL_CLASS_PACDOT
+#define CELL_CLASS_PEL CELL_CLASS_PELLET
+#define CELL_CLASS_HZ CELL_CLASS_HORIZONTAL
+#define CELL_CLASS_VT CELL_CLASS_VERTICAL
+#define CELL_CLASS_DR CELL_CLASS_DOWN_AND_RIGHT
+#define CELL_CLASS_DL CELL_CLASS_DOWN_AND_LEFT
+#define CELL_CLASS_UR CELL_CLASS_UP_AND_RIGHT
+#define CELL_CLASS_UL CELL_CLASS_UP_AND_LEFT
+#define CELL_CLASS_VR CELL_CLASS_VERTICAL_AND_RIGHT
+#define CELL_CLASS_VL CELL_CLASS_VERTICAL_AND_LEFT
+#define CELL_CLASS_HU CELL_CLASS_HORIZONTAL_AND_UP
+#define CELL_CLASS_HD CELL_CLASS_HORIZONTAL_AND_DOWN
+#define CELL_CLASS_VH CELL_CLASS_VERTICAL_AND_HORIZONTAL
+#define CELL_CLASS_FIL CELL_CLASS_FILLED
+
+#if FIELD_WIDTH == 31 && FIELD_HEIGHT == 31
+
+// Level 1 (mirrored) - 259 bytes, 346 walkable cells
+//   F-------------v-v-------------7
+//   |.............| |.............|
+//   |.F---7.F---7.| |.F---7.F---7.|
+//   |.|   |.L---J.L-J.L---J.|   |.|
+//   |.|   |.................|   |.|
+//   |.|   |.F---7.F-7.F---7.|   |.|
+//   |PL---J.L---J.L-J.L---J.L---JP|
+//   |.............................|
+//   |.F---7.F7.F-------7.F7.F---7.|
+//   |.L---J.||.L--7 F--J.||.L---J.|
+//   |.......||....| |....||.......|
+//   L-----7.|L--7 | | F--J|.F-----J
+//         |.|F--J L-J L--7|.|      
+//         |.||           ||.|      
+//   ------J.LJ F--   --7 LJ.L------
+//          .   |       |   .       
+//   ------7.F7 L-------J F7.F------
+//         |.||           ||.|      
+//         |.|| F-------7 ||.|      
+//   F-----J.LJ L--7 F--J LJ.L-----7
+//   |.............| |.............|
+//   |.F---7.F---7.| |.F---7.F---7.|
+//   |.L-7 |.L---J.L-J.L---J.| F-J.|
+//   |P..| |........ ........| |..P|
+//   >-7.| |.F7.F-------7.F7.| |.F-<
+//   >-J.L-J.||.L--7 F--J.||.L-J.L-<
+//   |.......||....| |....||.......|
+//   |.F-----JL--7.| |.F--JL-----7.|
+//   |.L---------J.L-J.L---------J.|
+//   |.............................|
+//   L-----------------------------J
+static const uint8_t level1_field[] PROGMEM = {
+	MAZE_MIRRORED,
+	R(DR,1), R(HZ,13), R(HD,1), R(HZ,1),
+	R(VT,1), R(DOT,13), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(DR,1), R(HZ,3), R(DL,1), R(DOT,1), R(DR,1), R(HZ,3), R(DL,1), R(DOT,1), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(VT,1), R(FIL,3), R(VT,1), R(DOT,1), R(UR,1), R(HZ,3), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1),
+	R(VT,1), R(DOT,1), R(VT,1), R(FIL,3), R(VT,1), R(DOT,9),
+	R(VT,1), R(DOT,1), R(VT,1), R(FIL,3), R(VT,1), R(DOT,1), R(DR,1), R(HZ,3), R(DL,1), R(DOT,1), R(DR,1), R(HZ,1),
+	R(VT,1), R(PEL,1), R(UR,1), R(HZ,3), R(UL,1), R(DOT,1), R(UR,1), R(HZ,3), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1),
+	R(VT,1), R(DOT,15),
+	R(VT,1), R(DOT,1), R(DR,1), R(HZ,3), R(DL,1), R(DOT,1), R(DR,1), R(DL,1), R(DOT,1), R(DR,1), R(HZ,4),
+	R(VT,1), R(DOT,1), R(UR,1), R(HZ,3), R(UL,1), R(DOT,1), R(VT,2), R(DOT,1), R(UR,1), R(HZ,2), R(DL,1), R(FIL,1),
+	R(VT,1), R(DOT,7), R(VT,2), R(DOT,4), R(VT,1), R(FIL,1),
+	R(UR,1), R(HZ,5), R(DL,1), R(DOT,1), R(VT,1), R(UR,1), R(HZ,2), R(DL,1), R(SP,1), R(VT,1), R(FIL,1),
+	R(FIL,6), R(VT,1), R(DOT,1), R(VT,1), R(DR,1), R(HZ,2), R(UL,1), R(SP,1), R(UR,1), R(HZ,1),
+	R(FIL,6), R(VT,1), R(DOT,1), R(VT,2), R(SP,6),
+	R(HZ,6), R(UL,1), R(DOT,1), R(UR,1), R(UL,1), R(SP,1), R(DR,1), R(HZ,2), R(SP,2),
+	R(SP,7), R(DOT,1), R(SP,3), R(VT,1), R(SP,4),
+	R(HZ,6), R(DL,1), R(DOT,1), R(DR,1), R(DL,1), R(SP,1), R(UR,1), R(HZ,4),
+	R(FIL,6), R(VT,1), R(DOT,1), R(VT,2), R(SP,6),
+	R(FIL,6), R(VT,1), R(DOT,1), R(VT,2), R(SP,1), R(DR,1), R(HZ,4),
+	R(DR,1), R(HZ,5), R(UL,1), R(DOT,1), R(UR,1), R(UL,1), R(SP,1), R(UR,1), R(HZ,2), R(DL,1), R(FIL,1),
+	R(VT,1), R(DOT,13), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(DR,1), R(HZ,3), R(DL,1), R(DOT,1), R(DR,1), R(HZ,3), R(DL,1), R(DOT,1), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(UR,1), R(HZ,1), R(DL,1), R(FIL,1), R(VT,1), R(DOT,1), R(UR,1), R(HZ,3), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1),
+	R(VT,1), R(PEL,1), R(DOT,2), R(VT,1), R(FIL,1), R(VT,1), R(DOT,8), R(SP,1),
+	R(VR,1), R(HZ,1), R(DL,1), R(DOT,1), R(VT,1), R(FIL,1), R(VT,1), R(DOT,1), R(DR,1), R(DL,1), R(DOT,1), R(DR,1), R(HZ,4),
+	R(VR,1), R(HZ,1), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1), R(UL,1), R(DOT,1), R(VT,2), R(DOT,1), R(UR,1), R(HZ,2), R(DL,1), R(FIL,1),
+	R(VT,1), R(DOT,7), R(VT,2), R(DOT,4), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(DR,1), R(HZ,5), R(UL,1), R(UR,1), R(HZ,2), R(DL,1), R(DOT,1), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(UR,1), R(HZ,9), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1),
+	R(VT,1), R(DOT,15),
+	R(UR,1), R(HZ,15),
+};
+static const uint16_t level1_cells[FIELD_HEIGHT + 1] PROGMEM = {
+	0, 0, 26, 32, 38, 57, 63, 69,
+	98, 104, 110, 132, 136, 140, 153, 160,
+	189, 193, 206, 210, 214, 240, 246, 252,
+	275, 281, 287, 309, 313, 317, 346, 346,
+};
+
+// Level 2 (mirrored) - 269 bytes, 338 walkable cells
+//   F-----------------------------7
+//   |.............................|
+//   |.F--7.F----7.F-7.F----7.F--7.|
+//   |P|  |.|    |.| |.|    |.|  |P|
+//   |.L--J.L----J.L-J.L----J.L--J.|
+//   |.............................|
+//   |.F--7.F-7.F-------7.F-7.F--7.|
+//   |.L--J.| |.L--7 F--J.| |.L--J.|
+//   |......| |....| |....| |......|
+//   >----7.| L--7.| |.F--J |.F----<
+//   |    |.L---7|.| |.|F---J.|    |
+//   |    |.....LJ.L-J.LJ.....|    |
+//   |    |.F-7           F-7.|    |
+//   |    |.| | F--   --7 | |.|    |
+//   L----J.L-J |       | L-J.L----J
+//         .... >-------< ....      
+//   F----7.F-7 |       | F-7.F----7
+//   |    |.| | L-------J | |.|    |
+//   |    |.| |           | |.|    |
+//   |    |.| |.F-------7.| |.|    |
+//   >----J.L-J.L--7 F--J.L-J.L----<
+//   |.............| |.............|
+//   |.F--7.F----7.| |.F----7.F--7.|
+//   |.L--J.L----J.L-J.L----J.L--J.|
+//   |P............. .............P|
+//   >--7.F-7.F-----------7.F-7.F--<
+//   >--J.| |.L----7 F----J.| |.L--<
+//   |....| |......| |......| |....|
+//   |.---^-^-----.L-J.-----^-^---.|
+//   |.............................|
+//   L-----------------------------J
+static const uint8_t level2_field[] PROGMEM = {
+	MAZE_MIRRORED,
+	R(DR,1), R(HZ,15),
+	R(VT,1), R(DOT,15),
+	R(VT,1), R(DOT,1), R(DR,1), R(HZ,2), R(DL,1), R(DOT,1), R(DR,1), R(HZ,4), R(DL,1), R(DOT,1), R(DR,1), R(HZ,1),
+	R(VT,1), R(PEL,1), R(VT,1), R(FIL,2), R(VT,1), R(DOT,1), R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(UR,1), R(HZ,2), R(UL,1), R(DOT,1), R(UR,1), R(HZ,4), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1),
+	R(VT,1), R(DOT,15),
+	R(VT,1), R(DOT,1), R(DR,1), R(HZ,2), R(DL,1), R(DOT,1), R(DR,1), R(HZ,1), R(DL,1), R(DOT,1), R(DR,1), R(HZ,4),
+	R(VT,1), R(DOT,1), R(UR,1), R(HZ,2), R(UL,1), R(DOT,1), R(VT,1), R(FIL,1), R(VT,1), R(DOT,1), R(UR,1), R(HZ,2), R(DL,1), R(FIL,1),
+	R(VT,1), R(DOT,6), R(VT,1), R(FIL,1), R(VT,1), R(DOT,4), R(VT,1), R(FIL,1),
+	R(VR,1), R(HZ,4), R(DL,1), R(DOT,1), R(VT,1), R(FIL,1), R(UR,1), R(HZ,2), R(DL,1), R(DOT,1), R(VT,1), R(FIL,1),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(UR,1), R(HZ,3), R(DL,1), R(VT,1), R(DOT,1), R(VT,1), R(FIL,1),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,5), R(UR,1), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(DR,1), R(HZ,1), R(DL,1), R(SP,6),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(VT,1), R(FIL,1), R(VT,1), R(SP,1), R(DR,1), R(HZ,2), R(SP,2),
+	R(UR,1), R(HZ,4), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1), R(UL,1), R(SP,1), R(VT,1), R(SP,4),
+	R(SP,6), R(DOT,4), R(SP,1), R(VR,1), R(HZ,4),
+	R(DR,1), R(HZ,4), R(DL,1), R(DOT,1), R(DR,1), R(HZ,1), R(DL,1), R(SP,1), R(VT,1), R(FIL,4),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(VT,1), R(FIL,1), R(VT,1), R(SP,1), R(UR,1), R(HZ,4),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(VT,1), R(FIL,1), R(VT,1), R(SP,6),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(VT,1), R(FIL,1), R(VT,1), R(DOT,1), R(DR,1), R(HZ,4),
+	R(VR,1), R(HZ,4), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1), R(UL,1), R(DOT,1), R(UR,1), R(HZ,2), R(DL,1), R(FIL,1),
+	R(VT,1), R(DOT,13), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(DR,1), R(HZ,2), R(DL,1), R(DOT,1), R(DR,1), R(HZ,4), R(DL,1), R(DOT,1), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(UR,1), R(HZ,2), R(UL,1), R(DOT,1), R(UR,1), R(HZ,4), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1),
+	R(VT,1), R(PEL,1), R(DOT,13), R(SP,1),
+	R(VR,1), R(HZ,2), R(DL,1), R(DOT,1), R(DR,1), R(HZ,1), R(DL,1), R(DOT,1), R(DR,1), R(HZ,6),
+	R(VR,1), R(HZ,2), R(UL,1), R(DOT,1), R(VT,1), R(FIL,1), R(VT,1), R(DOT,1), R(UR,1), R(HZ,4), R(DL,1), R(FIL,1),
+	R(VT,1), R(DOT,4), R(VT,1), R(FIL,1), R(VT,1), R(DOT,6), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(HZ,3), R(HU,1), R(HZ,1), R(HU,1), R(HZ,5), R(DOT,1), R(UR,1), R(HZ,1),
+	R(VT,1), R(DOT,15),
+	R(UR,1), R(HZ,15),
+};
+static const uint16_t level2_cells[FIELD_HEIGHT + 1] PROGMEM = {
+	0, 0, 29, 35, 41, 47, 76, 82,
+	88, 108, 112, 116, 128, 141, 148, 159,
+	181, 185, 189, 202, 206, 210, 236, 242,
+	248, 277, 281, 285, 305, 309, 338, 338,
+};
+
+// Level 3 (mirrored) - 240 bytes, 330 walkable cells
+//   F------------v---v------------7
+//   |............|   |............|
+//   |PF--------7.|   |.F--------7P|
+//   |.L--------J.L---J.L--------J.|
+//   |.............................|
+//   >-7.F7.F---------------7.F7.F-<
+//   | |.LJ.L--7         F--J.LJ.| |
+//   | |.......|         |.......| |
+//   L-J.F7.F7.L---------J.F7.F7.L-J
+//      .||.||.............||.||.   
+//   F---J|.||.-----------.||.|L---7
+//   |    |.||             ||.|    |
+//   |    |.|| F---   ---7 ||.|    |
+//   |    |.|| |         | ||.|    |
+//   |    |.|| >---------< ||.|    |
+//   |    |.|| |         | ||.|    |
+//   |    |.LJ L---------J LJ.|    |
+//   |    |...................|    |
+//   |    |.F7.F---------7.F7.|    |
+//   L----J.LJ.|         |.LJ.L----J
+//      .......|         |.......   
+//   |.|.F7.F7.|         |.F7.F7.|.|
+//   |.|.||.LJ.L---------J.LJ.||.|.|
+//   |.|.||......... .........||.|.|
+//   |.|.||.F---7.F---7.F---7.||.|.|
+//   |.|.LJ.L---J.|   |.L---J.LJ.|.|
+//   |............|   |............|
+//   |.F--7.F---7.|   |.F---7.F--7.|
+//   |PL--J.L---J.L---J.L---J.L--JP|
+//   |.............................|
+//   L-----------------------------J
+static const uint8_t level3_field[] PROGMEM = {
+	MAZE_MIRRORED,
+	R(DR,1), R(HZ,12), R(HD,1), R(HZ,2),
+	R(VT,1), R(DOT,12), R(VT,1), R(FIL,2),
+	R(VT,1), R(PEL,1), R(DR,1), R(HZ,8), R(DL,1), R(DOT,1), R(VT,1), R(FIL,2),
+	R(VT,1), R(DOT,1), R(UR,1), R(HZ,8), R(UL,1), R(DOT,1), R(UR,1), R(HZ,2),
+	R(VT,1), R(DOT,15),
+	R(VR,1), R(HZ,1), R(DL,1), R(DOT,1), R(DR,1), R(DL,1), R(DOT,1), R(DR,1), R(HZ,8),
+	R(VT,1), R(FIL,1), R(VT,1), R(DOT,1), R(UR,1), R(UL,1), R(DOT,1), R(UR,1), R(HZ,2), R(DL,1), R(FIL,5),
+	R(VT,1), R(FIL,1), R(VT,1), R(DOT,7), R(VT,1), R(FIL,5),
+	R(UR,1), R(HZ,1), R(UL,1), R(DOT,1), R(DR,1), R(DL,1), R(DOT,1), R(DR,1), R(DL,1), R(DOT,1), R(UR,1), R(HZ,5),
+	R(SP,3), R(DOT,1), R(VT,2), R(DOT,1), R(VT,2), R(DOT,7),
+	R(DR,1), R(HZ,3), R(UL,1), R(VT,1), R(DOT,1), R(VT,2), R(DOT,1), R(HZ,6),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(VT,2), R(SP,7),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(VT,2), R(SP,1), R(DR,1), R(HZ,3), R(SP,2),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(VT,2), R(SP,1), R(VT,1), R(SP,5),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(VT,2), R(SP,1), R(VR,1), R(HZ,5),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(VT,2), R(SP,1), R(VT,1), R(FIL,5),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(UR,1), R(UL,1), R(SP,1), R(UR,1), R(HZ,5),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,10),
+	R(VT,1), R(FIL,4), R(VT,1), R(DOT,1), R(DR,1), R(DL,1), R(DOT,1), R(DR,1), R(HZ,5),
+	R(UR,1), R(HZ,4), R(UL,1), R(DOT,1), R(UR,1), R(UL,1), R(DOT,1), R(VT,1), R(FIL,5),
+	R(SP,3), R(DOT,7), R(VT,1), R(FIL,5),
+	R(VT,1), R(DOT,1), R(VT,1), R(DOT,1), R(DR,1), R(DL,1), R(DOT,1), R(DR,1), R(DL,1), R(DOT,1), R(VT,1), R(FIL,5),
+	R(VT,1), R(DOT,1), R(VT,1), R(DOT,1), R(VT,2), R(DOT,1), R(UR,1), R(UL,1), R(DOT,1), R(UR,1), R(HZ,5),
+	R(VT,1), R(DOT,1), R(VT,1), R(DOT,1), R(VT,2), R(DOT,9), R(SP,1),
+	R(VT,1), R(DOT,1), R(VT,1), R(DOT,1), R(VT,2), R(DOT,1), R(DR,1), R(HZ,3), R(DL,1), R(DOT,1), R(DR,1), R(HZ,2),
+	R(VT,1), R(DOT,1), R(VT,1), R(DOT,1), R(UR,1), R(UL,1), R(DOT,1), R(UR,1), R(HZ,3), R(UL,1), R(DOT,1), R(VT,1), R(FIL,2),
+	R(VT,1), R(DOT,12), R(VT,1), R(FIL,2),
+	R(VT,1), R(DOT,1), R(DR,1), R(HZ,2), R(DL,1), R(DOT,1), R(DR,1), R(HZ,3), R(DL,1), R(DOT,1), R(VT,1), R(FIL,2),
+	R(VT,1), R(PEL,1), R(UR,1), R(HZ,2), R(UL,1), R(DOT,1), R(UR,1), R(HZ,3), R(UL,1), R(DOT,1), R(UR,1), R(HZ,2),
+	R(VT,1), R(DOT,15),
+	R(UR,1), R(HZ,15),
+};
+static const uint16_t level3_cells[FIELD_HEIGHT + 1] PROGMEM = {
+	0, 0, 24, 28, 32, 61, 65, 69,
+	83, 89, 112, 116, 131, 138, 151, 155,
+	159, 163, 182, 186, 190, 210, 218, 226,
+	249, 257, 265, 289, 295, 301, 330, 330,
+};
+
+const LevelDefinition level_definitions[NUM_LEVELS] PROGMEM = {
+	{
+		level1_field, level1_cells,
+		15, 23,				// pac-man
+		15, 12, 18,			// ghost home
+		14, 14, 16,			// ghost home entry
+		{ 15, NO_TUNNEL },	// tunnels
+		7					// tunnel length
+	},
+	{
+		level2_field, level2_cells,
+		15, 24,
+		14, 12, 18,
+		13, 14, 16,
+		{ 15, NO_TUNNEL },
+		6
+	},
+	{
+		level3_field, level3_cells,
+		15, 23,
+		13, 11, 19,
+		12, 14, 16,
+		{ 9, 20 },
+		3
+	}
+};
+
+#elif FIELD_WIDTH == 47 && FIELD_HEIGHT == 31
+
+// Wide maze (mirrored) - 266 bytes, 458 walkable cells. This is level 1 with
+// every row stretched by 8 cells on each side, to show that fields of other
+// sizes work (build with -DFIELD_WIDTH=47 - see levels.h). There is only
+// the one maze at this size.
+//   F---------------------v-v---------------------7
+//   |.....................| |.....................|
+//   |.F-----------7.F---7.| |.F---7.F-----------7.|
+//   |.|           |.L---J.L-J.L---J.|           |.|
+//   |.|           |.................|           |.|
+//   |.|           |.F---7.F-7.F---7.|           |.|
+//   |PL-----------J.L---J.L-J.L---J.L-----------JP|
+//   |.............................................|
+//   |.F-----------7.F7.F-------7.F7.F-----------7.|
+//   |.L-----------J.||.L--7 F--J.||.L-----------J.|
+//   |...............||....| |....||...............|
+//   L-------------7.|L--7 | | F--J|.F-------------J
+//                 |.|F--J L-J L--7|.|              
+//                 |.||           ||.|              
+//   --------------J.LJ F--   --7 LJ.L--------------
+//                  .   |       |   .               
+//   --------------7.F7 L-------J F7.F--------------
+//                 |.||           ||.|              
+//                 |.|| F-------7 ||.|              
+//   F-------------J.LJ L--7 F--J LJ.L-------------7
+//   |.....................| |.....................|
+//   |.F-----------7.F---7.| |.F---7.F-----------7.|
+//   |.L-7         |.L---J.L-J.L---J.|         F-J.|
+//   |P..|         |........ ........|         |..P|
+//   >-7.|         |.F7.F-------7.F7.|         |.F-<
+//   >-J.L---------J.||.L--7 F--J.||.L---------J.L-<
+//   |...............||....| |....||...............|
+//   |.F-------------JL--7.| |.F--JL-------------7.|
+//   |.L-----------------J.L-J.L-----------------J.|
+//   |.............................................|
+//   L---------------------------------------------J
+static const uint8_t level1_wide_field[] PROGMEM = {
+	MAZE_MIRRORED,
+	R(DR,1), R(HZ,16), R(HZ,5), R(HD,1), R(HZ,1),
+	R(VT,1), R(DOT,16), R(DOT,5), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(DR,1), R(HZ,11), R(DL,1), R(DOT,1), R(DR,1), R(HZ,3), R(DL,1), R(DOT,1), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(VT,1), R(FIL,11), R(VT,1), R(DOT,1), R(UR,1), R(HZ,3), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1),
+	R(VT,1), R(DOT,1), R(VT,1), R(FIL,11), R(VT,1), R(DOT,9),
+	R(VT,1), R(DOT,1), R(VT,1), R(FIL,11), R(VT,1), R(DOT,1), R(DR,1), R(HZ,3), R(DL,1), R(DOT,1), R(DR,1), R(HZ,1),
+	R(VT,1), R(PEL,1), R(UR,1), R(HZ,11), R(UL,1), R(DOT,1), R(UR,1), R(HZ,3), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1),
+	R(VT,1), R(DOT,16), R(DOT,7),
+	R(VT,1), R(DOT,1), R(DR,1), R(HZ,11), R(DL,1), R(DOT,1), R(DR,1), R(DL,1), R(DOT,1), R(DR,1), R(HZ,4),
+	R(VT,1), R(DOT,1), R(UR,1), R(HZ,11), R(UL,1), R(DOT,1), R(VT,2), R(DOT,1), R(UR,1), R(HZ,2), R(DL,1), R(FIL,1),
+	R(VT,1), R(DOT,15), R(VT,2), R(DOT,4), R(VT,1), R(FIL,1),
+	R(UR,1), R(HZ,13), R(DL,1), R(DOT,1), R(VT,1), R(UR,1), R(HZ,2), R(DL,1), R(SP,1), R(VT,1), R(FIL,1),
+	R(FIL,14), R(VT,1), R(DOT,1), R(VT,1), R(DR,1), R(HZ,2), R(UL,1), R(SP,1), R(UR,1), R(HZ,1),
+	R(FIL,14), R(VT,1), R(DOT,1), R(VT,2), R(SP,6),
+	R(HZ,14), R(UL,1), R(DOT,1), R(UR,1), R(UL,1), R(SP,1), R(DR,1), R(HZ,2), R(SP,2),
+	R(SP,15), R(DOT,1), R(SP,3), R(VT,1), R(SP,4),
+	R(HZ,14), R(DL,1), R(DOT,1), R(DR,1), R(DL,1), R(SP,1), R(UR,1), R(HZ,4),
+	R(FIL,14), R(VT,1), R(DOT,1), R(VT,2), R(SP,6),
+	R(FIL,14), R(VT,1), R(DOT,1), R(VT,2), R(SP,1), R(DR,1), R(HZ,4),
+	R(DR,1), R(HZ,13), R(UL,1), R(DOT,1), R(UR,1), R(UL,1), R(SP,1), R(UR,1), R(HZ,2), R(DL,1), R(FIL,1),
+	R(VT,1), R(DOT,16), R(DOT,5), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(DR,1), R(HZ,11), R(DL,1), R(DOT,1), R(DR,1), R(HZ,3), R(DL,1), R(DOT,1), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(UR,1), R(HZ,1), R(DL,1), R(FIL,9), R(VT,1), R(DOT,1), R(UR,1), R(HZ,3), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1),
+	R(VT,1), R(PEL,1), R(DOT,2), R(VT,1), R(FIL,9), R(VT,1), R(DOT,8), R(SP,1),
+	R(VR,1), R(HZ,1), R(DL,1), R(DOT,1), R(VT,1), R(FIL,9), R(VT,1), R(DOT,1), R(DR,1), R(DL,1), R(DOT,1), R(DR,1), R(HZ,4),
+	R(VR,1), R(HZ,1), R(UL,1), R(DOT,1), R(UR,1), R(HZ,9), R(UL,1), R(DOT,1), R(VT,2), R(DOT,1), R(UR,1), R(HZ,2), R(DL,1), R(FIL,1),
+	R(VT,1), R(DOT,15), R(VT,2), R(DOT,4), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(DR,1), R(HZ,13), R(UL,1), R(UR,1), R(HZ,2), R(DL,1), R(DOT,1), R(VT,1), R(FIL,1),
+	R(VT,1), R(DOT,1), R(UR,1), R(HZ,16), R(HZ,1), R(UL,1), R(DOT,1), R(UR,1), R(HZ,1),
+	R(VT,1), R(DOT,16), R(DOT,7),
+	R(UR,1), R(HZ,16), R(HZ,7),
+};
+static const uint16_t level1_wide_cells[FIELD_HEIGHT + 1] PROGMEM = {
+	0, 0, 42, 48, 54, 73, 79, 85,
+	130, 136, 142, 180, 184, 188, 201, 208,
+	253, 257, 270, 274, 278, 320, 326, 332,
+	355, 361, 367, 405, 409, 413, 458, 458,
+};
+
+const LevelDefinition level_definitions[NUM_LEVELS] PROGMEM = {
+	{
+		level1_wide_field, level1_wide_cells,
+		23, 23,				// pac-man
+		15, 20, 26,			// ghost home
+		14, 22, 24,			// ghost home entry
+		{ 15, NO_TUNNEL },	// tunnels
+		15					// tunnel length
+	}
+};
+
+#else
+#error "There are no mazes for the configured field size - add some above"
+#endif /* FIELD_WIDTH, FIELD_HEIGHT */
+
+
+///////////////////////////////////////////////////////////
+// Speeds
+// The game gets harder as the levels go on - everything speeds up, the
+// ghosts catch up with the pac-man and the power pellets don't last as long.
+// Ghosts always slow right down in the tunnels and when frightened.
+const LevelSpeeds level_speeds[NUM_SPEED_LEVELS] PROGMEM = {
+	{
+		SPEED(400), SPEED(360),			// pac-man: normal, frightened ghosts
+		{ SPEED(420), SPEED(450), SPEED(500), SPEED(570) },	// ghosts
+		SPEED(800), SPEED(900),			// ghosts: frightened, tunnel
+		6000							// frightened time
+	},
+	{
+		SPEED(380), SPEED(340),
+		{ SPEED(400), SPEED(430), SPEED(470), SPEED(530) },
+		SPEED(760), SPEED(850),
+		5000
+	},
+	{
+		SPEED(360), SPEED(330),
+		{ SPEED(380), SPEED(405), SPEED(440), SPEED(500) },
+		SPEED(720), SPEED(800),
+		4000
+	},
+	{
+		SPEED(340), SPEED(320),
+		{ SPEED(350), SPEED(375), SPEED(410), SPEED(460) },
+		SPEED(680), SPEED(760),
+		3000
+	}
+};
@@ -0,0 +1,91 @@
+/*
+ * levels.h
+ *
+ * Definitions of the game levels. Each level has its own maze, ghost
+ * home, pac-man starting location and tunnels. All of this data is 
+ * stored in program memory (flash) - use pgm_read_byte() etc. to access 
+ * it.
+ */
+
+#ifndef LEVELS_H_
+#define LEVELS_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "game.h"
+
+// Number of different mazes (for the field size - see levels.c) and the
+// maximum number of walkable (not wall) cells in any of them. Levels
+// beyond NUM_LEVELS repeat the mazes.
+#if FIELD_WIDTH == 31 && FIELD_HEIGHT == 31
+#define NUM_LEVELS 3
+#ifndef MAX_WALKABLE_CELLS
+#define MAX_WALKABLE_CELLS 352
+#endif
+#else
+#define NUM_LEVELS 1
+#ifndef MAX_WALKABLE_CELLS
+#define MAX_WALKABLE_CELLS 464
+#endif
+#endif
+
+// Maximum number of power pellets in a maze
+#define MAX_PELLETS 8
+
+// Maximum number of tunnel rows in a maze
+#define MAX_TUNNELS 2
+// Value used in tunnel_rows[] for an unused entry
+#define NO_TUNNEL 0xFF
+
+typedef struct {
+	// Maze layout - compressed as described in maze.h
+	const uint8_t* field;
+	// Index of the first walkable cell in each row (FIELD_HEIGHT+1 entries,
+	// the last being the number of walkable cells) - see levels.c
+	const uint16_t* cells;
+	// Initial pac-man location
+	uint8_t pacman_x;
+	uint8_t pacman_y;
+	// Location of the ghosts' home - ghosts start every 2 cells from 
+	// (ghost_home_x_left, ghost_home_y). The entry to the home is the gap
+	// in the wall above it.
+	uint8_t ghost_home_y;
+	uint8_t ghost_home_x_left;
+	uint8_t ghost_home_x_right;
+	uint8_t ghost_home_entry_y;
+	uint8_t ghost_home_entry_x_left;
+	uint8_t ghost_home_entry_x_right;
+	// Rows on which the pac-man can leave one side of the field and
+	// appear on the other (NO_TUNNEL if not used)
+	uint8_t tunnel_rows[MAX_TUNNELS];
+	// Number of cells at each end of a tunnel row that are inside the
+	// tunnel (ghosts are slowed down there)
+	uint8_t tunnel_length;
+} LevelDefinition;
+
+extern const LevelDefinition level_definitions[NUM_LEVELS] PROGMEM;
+
+// Speeds are the fraction of a cell moved per millisecond of game time, in
+// units of 1/65536 of a cell. SPEED() converts from the (easier to think
+// about) number of milliseconds it takes to move one cell.
+#define SPEED(ms_per_cell) ((uint16_t)((65536UL + (ms_per_cell) / 2) / (ms_per_cell)))
+
+// Number of entries in the difficulty ramp. Levels beyond this use the
+// last entry.
+#define NUM_SPEED_LEVELS 4
+
+typedef struct {
+	// Pac-man speed normally and while the ghosts are frightened
+	uint16_t pacman;
+	uint16_t pacman_frightened;
+	// Speed of each ghost normally, while frightened and in a tunnel
+	uint16_t ghost[NUM_GHOSTS];
+	uint16_t ghost_frightened;
+	uint16_t ghost_tunnel;
+	// How long (ms) a power pellet lasts
+	uint16_t frightened_time;
+} LevelSpeeds;
+
+extern const LevelSpeeds level_speeds[NUM_SPEED_LEVELS] PROGMEM;
+
+#endif /* LEVELS_H_ */
@@ -0,0 +1,66 @@
+/*
+ * maze.c
+ *
+ * Decoder for compressed mazes - see maze.h for the format.
+ */
+
+#include <avr/pgmspace.h>
+#include "maze.h"
+
+// The class of the mirror image of each cell class (e.g. a wall going down
+// and right becomes one going down and left)
+static const uint8_t mirrored_cell_class[NUM_CELL_CLASSES] PROGMEM = {
+	CELL_CLASS_SPACE, CELL_CLASS_PACDOT, CELL_CLASS_PELLET,
+	CELL_CLASS_HORIZONTAL, CELL_CLASS_VERTICAL,
+	CELL_CLASS_DOWN_AND_LEFT, CELL_CLASS_DOWN_AND_RIGHT,
+	CELL_CLASS_UP_AND_LEFT, CELL_CLASS_UP_AND_RIGHT,
+	CELL_CLASS_VERTICAL_AND_LEFT, CELL_CLASS_VERTICAL_AND_RIGHT,
+	CELL_CLASS_HORIZONTAL_AND_UP, CELL_CLASS_HORIZONTAL_AND_DOWN,
+	CELL_CLASS_VERTICAL_AND_HORIZONTAL, CELL_CLASS_FILLED
+};
+
+void maze_decoder_start(MazeDecoder* decoder, const uint8_t* encoded_maze) {
+	decoder->flags = pgm_read_byte(encoded_maze);
+	decoder->next_byte = encoded_maze + 1;
+	decoder->x = 0;
+	decoder->run_remaining = 0;
+}
+
+uint8_t maze_decoder_next(MazeDecoder* decoder) {
+	uint8_t x = decoder->x;
+	uint8_t cell_class;
+	
+	if((decoder->flags & MAZE_MIRRORED) && x >= MAZE_HALF_WIDTH) {
+		// Right hand side of a mirrored row - look up the cell on the 
+		// left hand side that this is the mirror image of
+		uint8_t mirror_x = FIELD_WIDTH - 1 - x;
+		cell_class = decoder->half_row[mirror_x / 2];
+		if(mirror_x & 1) {
+			cell_class >>= 4;
+		}
+		cell_class = pgm_read_byte(&mirrored_cell_class[cell_class & 0x0F]);
+	} else {
+		if(decoder->run_remaining == 0) {
+			// Start the next run
+			uint8_t run = pgm_read_byte(decoder->next_byte++);
+			decoder->run_class = run >> 4;
+			decoder->run_remaining = (run & 0x0F) + 1;
+		}
+		decoder->run_remaining--;
+		cell_class = decoder->run_class;
+		if(decoder->flags & MAZE_MIRRORED) {
+			// Remember this cell for when we get to the other side of the row
+			if(x & 1) {
+				decoder->half_row[x / 2] |= (cell_class << 4);
+			} else {
+				decoder->half_row[x / 2] = cell_class;
+			}
+		}
+	}
+	
+	if(++x == FIELD_WIDTH) {
+		x = 0;
+	}
+	decoder->x = x;
+	return cell_class;
+}
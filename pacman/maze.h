@@ -0,0 +1,76 @@
+/*
+ * maze.h
+ *
+ * Compressed maze storage. A maze is stored in program memory as a 
+ * stream of bytes:
+ *	- a flags byte (MAZE_MIRRORED if the right hand side of the maze is
+ *	  the mirror image of the left, 0 otherwise)
+ *	- then, for each row from the top, a sequence of runs. Each run is one
+ *	  byte - the high 4 bits are the cell class (CELL_CLASS_ values below)
+ *	  and the low 4 bits are the run length minus 1 (i.e. 1 to 16 cells).
+ *	  Runs never cross from one row to the next. For a mirrored maze only 
+ *	  the left hand FIELD_WIDTH/2 + 1 cells of each row (up to and including
+ *	  the middle column) are stored.
+ * The cells are read back one at a time (in row order, left to right) with
+ * a MazeDecoder so the maze never has to be expanded in RAM.
+ * tools/encode_maze.py produces this format from a maze picture.
+ */
+
+#ifndef MAZE_H_
+#define MAZE_H_
+
+#include <stdint.h>
+#include "game.h"
+
+#define MAZE_MIRRORED 0x01
+
+// Cell classes. Walls all have class CELL_CLASS_FIRST_WALL or higher.
+// The wall classes are named after the line drawing character used
+// (see line_drawing_characters.h).
+#define CELL_CLASS_SPACE 0
+#define CELL_CLASS_PACDOT 1
+#define CELL_CLASS_PELLET 2
+#define CELL_CLASS_HORIZONTAL 3
+#define CELL_CLASS_VERTICAL 4
+#define CELL_CLASS_DOWN_AND_RIGHT 5
+#define CELL_CLASS_DOWN_AND_LEFT 6
+#define CELL_CLASS_UP_AND_RIGHT 7
+#define CELL_CLASS_UP_AND_LEFT 8
+#define CELL_CLASS_VERTICAL_AND_RIGHT 9
+#define CELL_CLASS_VERTICAL_AND_LEFT 10
+#define CELL_CLASS_HORIZONTAL_AND_UP 11
+#define CELL_CLASS_HORIZONTAL_AND_DOWN 12
+#define CELL_CLASS_VERTICAL_AND_HORIZONTAL 13
+// A space that can't be reached (e.g. inside a block of walls). It is shown
+// as a space but treated as a wall.
+#define CELL_CLASS_FILLED 14
+#define NUM_CELL_CLASSES 15
+#define CELL_CLASS_FIRST_WALL CELL_CLASS_HORIZONTAL
+
+// Number of cells stored for each row of a mirrored maze
+#define MAZE_HALF_WIDTH (FIELD_WIDTH/2 + 1)
+
+typedef struct {
+	// Next byte of the encoded maze (in program memory)
+	const uint8_t* next_byte;
+	uint8_t flags;
+	// Column of the next cell to be returned
+	uint8_t x;
+	// Class of the current run and the number of cells left in it
+	uint8_t run_class;
+	uint8_t run_remaining;
+	// Left hand side of the current row - two cells per byte (only used
+	// for mirrored mazes)
+	uint8_t half_row[(MAZE_HALF_WIDTH + 1)/2];
+} MazeDecoder;
+
+// Start decoding the given encoded maze (which is in program memory) from
+// the top left cell.
+void maze_decoder_start(MazeDecoder* decoder, const uint8_t* encoded_maze);
+
+// Return the class of the next cell. Cells are returned row by row, left
+// to right within each row. Must be called no more than 
+// FIELD_WIDTH * FIELD_HEIGHT times after maze_decoder_start().
+uint8_t maze_decoder_next(MazeDecoder* decoder);
+
+#endif /* MAZE_H_ */
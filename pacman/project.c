@@ -9,6 +9,7 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
+#include <avr/sleep.h>
 #include <stdio.h>
 
 #include "ledmatrix.h"
@@ -19,7 +20,21 @@
 #include "terminalio.h"
 #include "score.h"
 #include "timer0.h"
+#include "timer1.h"
+#include "project.h"
 #include "game.h"
+#include "game_display.h"
+#include "led_map.h"
+#include "sound.h"
+#include "highscores.h"
+#include "levels.h"
+#include "input_log.h"
+#include "snapshot.h"
+#include "autopilot.h"
+#include "ghost_search.h"
+#include "scheduler.h"
+#include "ram_usage.h"
+#include "pt.h"
 
 
 #define F_CPU 8000000L
@@ -28,14 +43,40 @@
 // Function prototypes - these are defined below (after main()) in the order
 // given here
 void initialise_hardware(void);
-void splash_screen(void);
+PT_THREAD(run_game(Protothread* pt));
+PT_THREAD(splash_screen(Protothread* pt));
 void new_game(void);
-void play_game(void);
-void handle_level_complete(void);
-void handle_game_over(void);
+PT_THREAD(play_game(Protothread* pt));
+int8_t play_game_pass(void);
+PT_THREAD(handle_level_complete(Protothread* pt));
+PT_THREAD(handle_game_over(Protothread* pt));
 void set_disp_lives(uint8_t num); 
 void display_lives(void); 
 void initialise_joystick(void) ;
+void report_loop_stats(void);
+void report_ledmatrix_stats(void);
+void report_maze_stats(void);
+#if RANDOM_COST_BENCH
+void report_random_cost(void);
+#endif
+void report_sound_stats(void);
+void replay_inputs(void);
+void show_replay_status(void);
+void show_pause_status(void);
+void update_display(void);
+void set_autopilot_mode(uint8_t mode);
+void show_autopilot_status(void);
+void report_autopilot_stats(void);
+void show_ghost_difficulty(void);
+void steer_pacman(int8_t direction);
+void initialise_tasks(void);
+void game_task(void);
+void joystick_task(void);
+void scroll_task(void);
+void change_scroll_period(int8_t change);
+void report_task_stats(void);
+void report_ram_usage(void);
+void sleep_if_idle(void);
 
 
 //Pause status (0=resume , 1 = pause ) 
@@ -46,21 +87,166 @@ uint8_t paused = 0;
 // ASCII code for Escape character
 #define ESCAPE_CHAR 27
 
+// Time (timer 1 counts, i.e. microseconds) each pass of the play_game() loop
+// may spend working out ghost moves ahead of time
+#define GHOST_PLAN_BUDGET 250
+
+// Periods (ms) of the tasks run by the main loop (see initialise_tasks()).
+// The game is moved on every millisecond (or on every pass in soak mode) 
+// but the joystick and the lives LEDs don't need to be looked at nearly as
+// often. Text on the LED matrix is scrolled by a pixel every 
+// SCROLL_TASK_PERIOD ms to start with - this can be changed (between 
+// MIN_SCROLL_PERIOD and MAX_SCROLL_PERIOD, SCROLL_PERIOD_STEP at a time) 
+// with '+' and '-'.
+#define GAME_TASK_PERIOD 1
+#define JOYSTICK_TASK_PERIOD 20
+#define LIVES_TASK_PERIOD 100
+#define SCROLL_TASK_PERIOD 150
+#define MIN_SCROLL_PERIOD 30
+#define MAX_SCROLL_PERIOD 300
+#define SCROLL_PERIOD_STEP 30
+
+// Task number of game_task(), so its period can be changed for soak mode
+static int8_t game_task_num;
+
+// Task number and period of scroll_task()
+static int8_t scroll_task_num;
+static uint16_t scroll_period = SCROLL_TASK_PERIOD;
+
+// Longest time (timer 1 counts) between the start of successive passes of the
+// play_game() loop, i.e. the worst case delay before input is responded to,
+// and when the last pass started
+static uint16_t max_loop_time;
+static uint16_t last_loop_start_time;
+
+// Largest number of milliseconds of game time that the main loop has had
+// to catch up on in one go
+static uint16_t max_catch_up;
+
+// Who is playing. With the autopilot on, the autopilot (see autopilot.h)
+// chooses the pac-man's direction instead of the buttons/joystick/keys:
+// - AUTOPILOT_ON: toggled with 'a' during a game
+// - AUTOPILOT_DEMO: attract mode - the autopilot plays from the splash 
+//   screen until a button is pushed
+// - AUTOPILOT_SOAK: toggled with 'z' - the game runs flat out (as fast as
+//   it can be drawn) rather than in real time, with a new game started 
+//   straight after each one ends, to soak test the game and the display
+#define AUTOPILOT_OFF 0
+#define AUTOPILOT_ON 1
+#define AUTOPILOT_DEMO 2
+#define AUTOPILOT_SOAK 3
+static uint8_t autopilot_mode;
+
+// Game ticks run on each pass of the play_game() loop in soak mode
+#define SOAK_TICKS_PER_PASS 50
+
+// Clock times when soak mode last started and stopped, and the number of
+// game ticks run (counted across games)
+static uint32_t soak_start_time;
+static uint32_t soak_end_time;
+static uint32_t soak_ticks;
+
+// Set if a demo game was ended by a button push
+static uint8_t demo_interrupted;
+
+// Set while play_game() is running - the game's tasks do nothing otherwise
+static uint8_t game_running;
+
+// Whether the CPU is put to sleep when there's nothing to do (toggled with 
+// 'i' to compare), the total time (microseconds) spent asleep since 
+// sleep_stats_start_time (timestamp, see get_timestamp()), and the longest
+// time between waking up and dealing with a button push or key press
+static uint8_t sleep_enabled = 1;
+static uint32_t sleep_time;
+static uint32_t sleep_stats_start_time;
+static uint16_t max_wake_latency;
+
+// Number of timer 0 interrupts when the game started
+static uint32_t interrupts_at_start;
+
+// Set on the pass of the main loop just after waking up, with the time 
+// (timer 1) we woke up
+static uint8_t woken;
+static uint16_t wake_time;
+
+// Ghost difficulty (GHOSTS_NORMAL or GHOSTS_HARD) for the next new game -
+// toggled with 'h'
+static uint8_t ghost_difficulty_selected;
+
+// What the replay status line is showing: whether a replay is running and
+// its number of mismatched keyframes. It is only redrawn when these change.
+static uint8_t replay_status_shown;
+static uint16_t replay_mismatches_shown;
+
 /////////////////////////////// main //////////////////////////////////
 int main(void) {
+	Protothread game_pt;
+	
 	// Setup hardware and call backs. This will turn on 
 	// interrupts.
 	initialise_hardware();
 	
-	// Show the splash screen message. Returns when display
+	PT_INIT(&game_pt);
+	while(1) {
+		// Run the game until it next has to wait (e.g. for a button push)
+		(void)run_game(&game_pt);
+		// Then do whatever is due whether the game is waiting or not
+		// (e.g. updating the lives LEDs)
+		run_due_tasks();
+		sleep_if_idle();
+	}
+}
+
+// Put the CPU to sleep until the next interrupt if there is nothing to do,
+// i.e. no task is due and there's no input waiting or ghost moves to plan.
+// Idle sleep mode is used so the timers (including timer 0, which will
+// wake us up when the next task is due), serial port, button (pin change)
+// and ADC interrupts all carry on.
+void sleep_if_idle(void) {
+	uint16_t sleep_start_time;
+	woken = 0;
+	if(!sleep_enabled) {
+		return;
+	}
+	// Interrupts are turned off while checking so that one that arrives 
+	// after the check still wakes us up. (The instruction after sei() is
+	// always run before any interrupt, so we get to sleep first.)
+	cli();
+	if(is_task_due() || button_pushes_waiting() || serial_input_available() ||
+			ghost_moves_to_plan()) {
+		sei();
+		return;
+	}
+	// Make sure the timer wakes us up when the next task is due
+	set_timer0_wakeup(get_next_deadline());
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_enable();
+	sleep_start_time = get_timer1_count();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+	// (Timer 1 keeps counting while we're asleep)
+	wake_time = get_timer1_count();
+	sleep_time += (uint16_t)(wake_time - sleep_start_time);
+	woken = 1;
+}
+
+// Show the splash screen, then play games one after the other. The 
+// protothreads (see pt.h) below return whenever they are waiting.
+PT_THREAD(run_game(Protothread* pt)) {
+	static Protothread child_pt;
+	
+	PT_BEGIN(pt);
+	// Show the splash screen message. Carries on when display
 	// is complete
-	splash_screen();
+	PT_SPAWN(pt, &child_pt, splash_screen(&child_pt));
 	
 	while(1) {
 		new_game();
-		play_game();
-		handle_game_over();
+		PT_SPAWN(pt, &child_pt, play_game(&child_pt));
+		PT_SPAWN(pt, &child_pt, handle_game_over(&child_pt));
 	}
+	PT_END(pt);
 }
 
 void initialise_hardware(void) {
@@ -72,41 +258,80 @@ void initialise_hardware(void) {
 	init_serial_stdio(19200,0);
 	
 	init_timer0();
+	init_timer1();
+	init_sound();
+	init_highscores();
+	initialise_tasks();
 	
 	// Turn on global interrupts
 	sei();
 }
 
-void splash_screen(void) {
-	// Clear terminal screen and output a message
-	clear_terminal();
-	move_cursor(10,10);
-	printf_P(PSTR("Pac-Man"));
-	move_cursor(10,12);
-	printf_P(PSTR("CSSE2010 project by <Juan Espares>"));
-	move_cursor(10,14); 
-	printf_P(PSTR("Student Number: 44317962")) ; 
-
-	// Output the scrolling message to the LED matrix
-	// and wait for a push button to be pushed.
-	ledmatrix_clear();
+PT_THREAD(splash_screen(Protothread* pt)) {
+	static Protothread demo_pt;
+	static uint8_t button_was_pushed;
+	
+	PT_BEGIN(pt);
 	while(1) {
-		set_scrolling_display_text("44317962", COLOUR_GREEN);
-		// Scroll the message until it has scrolled off the 
-		// display or a button is pushed
-		while(scroll_display()) {
-			_delay_ms(150);
-			if(button_pushed() != NO_BUTTON_PUSHED) {
-				ledmatrix_clear();
-				return;
+		// Clear terminal screen and output a message
+		clear_terminal();
+		move_cursor(10,10);
+		printf_P(PSTR("Pac-Man"));
+		move_cursor(10,12);
+		printf_P(PSTR("CSSE2010 project by <Juan Espares>"));
+		move_cursor(10,14); 
+		printf_P(PSTR("Student Number: 44317962")) ; 
+		move_cursor(10,16);
+		printf_P(PSTR("High scores:"));
+		for(uint8_t i = 0; i < NUM_HIGH_SCORES; i++) {
+			printf_P(PSTR(" %lu"), get_highscore_entry(i));
+		}
+
+		// Output the scrolling message to the LED matrix
+		// and wait for a push button to be pushed.
+		ledmatrix_clear();
+		clear_scrolling_text();
+		queue_scrolling_text_P(PSTR("44317962"), COLOUR_GREEN);
+		// The message is scrolled by scroll_task() until it has 
+		// scrolled off the display or a button is pushed
+		button_was_pushed = 0;
+		PT_WAIT_UNTIL(pt, (button_was_pushed = (button_pushed() != NO_BUTTON_PUSHED)) ||
+				!is_text_scrolling());
+		// If nobody has pushed a button, show a demo game (attract mode -
+		// the autopilot plays) until they do
+		if(!button_was_pushed) {
+			set_random_state(joystick_noise() ^ get_timer1_count());
+			set_autopilot_mode(AUTOPILOT_DEMO);
+			demo_interrupted = 0;
+			new_game();
+			PT_SPAWN(pt, &demo_pt, play_game(&demo_pt));
+			set_autopilot_mode(AUTOPILOT_OFF);
+			if(!demo_interrupted) {
+				// The demo game finished - back to the message
+				continue;
 			}
 		}
+		clear_scrolling_text();
+		ledmatrix_clear();
+		// Seed the game's random numbers from ADC noise and
+		// exactly when (to the microsecond) the button was pushed
+		set_random_state(joystick_noise() ^ get_timer1_count());
+		PT_EXIT(pt);
 	}
+	PT_END(pt);
 }
 
 void new_game(void) {
+	// A replayed game has the difficulty it was recorded with (already set)
+	if(!is_replaying()) {
+		set_ghost_difficulty(ghost_difficulty_selected);
+	}
+	// Record the start of the game so it can be replayed (nothing is 
+	// recorded if this game is itself being replayed)
+	log_new_game(get_random_state(), get_ghost_difficulty());
 	
 	paused = 0 ; 
+	set_clock_paused(0);
 	// Initialise the game and display
 	initialise_game();
 	
@@ -116,188 +341,451 @@ void new_game(void) {
 	//Reset Pacman Lives 
 	set_disp_lives(0); 
 	
+	// Draw the new game
+	update_display();
+	
 	// Clear a button push or serial input if any are waiting
 	// (The cast to void means the return value is ignored.)
 	(void)button_pushed();
 	clear_serial_input_buffer();
 }
 
-void play_game(void) {
-	uint32_t current_time;
-	uint32_t pacman_last_move_time;
-	uint32_t ghost_last_move_time;
-	uint32_t ghost_last_move_time1; 
-	uint32_t ghost_last_move_time2; 
-	uint32_t ghost_last_move_time3; 
-	
-	int8_t button , joystick ; 
-	char serial_input, escape_sequence_char;
-	uint8_t characters_into_escape_sequence = 0;
+PT_THREAD(play_game(Protothread* pt)) {
+	static Protothread level_complete_pt;
 	
-	// Get the current time and remember this as the last time the projectiles
-    // were moved.
-	current_time = get_current_time();
-	pacman_last_move_time = current_time;
-	ghost_last_move_time = current_time;
-	ghost_last_move_time1 = current_time; 
-	ghost_last_move_time2 = current_time; 
-	ghost_last_move_time3 = current_time;
-	 
+	PT_BEGIN(pt);
+	max_catch_up = 0;
+	last_loop_start_time = get_timer1_count();
+	max_loop_time = 0;
+	restart_tasks();
+	clear_task_stats();
+	sleep_time = 0;
+	sleep_stats_start_time = get_timestamp();
+	max_wake_latency = 0;
+	interrupts_at_start = get_timer0_interrupts();
+	game_running = 1;
 	
 	// We play the game until it's over
 	while(!is_game_over() && (get_lives() > 0) ) {
-		// Check for input - which could be a button push or serial input.
-		// Serial input may be part of an escape sequence, e.g. ESC [ D
-		// is a left cursor key press. At most one of the following three
-		// variables will be set to a value other than -1 if input is available.
-		// (We don't initalise button to -1 since button_pushed() will return -1
-		// if no button pushes are waiting to be returned.)
-		// Button pushes take priority over serial input. If there are both then
-		// we'll retrieve the serial input the next time through this loop
-		serial_input = -1;
-		escape_sequence_char = -1;
-		button = button_pushed();
-		display_lives(); 
-		
-		
-		
-		
-		if(button == NO_BUTTON_PUSHED) {
-			// No push button was pushed, see if there is any serial input
-			if(serial_input_available()) {
-				// Serial data was available - read the data from standard input
-				serial_input = fgetc(stdin);
-				// Check if the character is part of an escape sequence
-				if(characters_into_escape_sequence == 0 && serial_input == ESCAPE_CHAR) {
-					// We've hit the first character in an escape sequence (escape)
-					characters_into_escape_sequence++;
-					serial_input = -1; // Don't further process this character
-				} else if(characters_into_escape_sequence == 1 && serial_input == '[') {
-					// We've hit the second character in an escape sequence
-					characters_into_escape_sequence++;
-					serial_input = -1; // Don't further process this character
-				} else if(characters_into_escape_sequence == 2) {
-					// Third (and last) character in the escape sequence
-					escape_sequence_char = serial_input;
-					serial_input = -1;  // Don't further process this character - we
-										// deal with it as part of the escape sequence
-					characters_into_escape_sequence = 0;
-				} else {
-					// Character was not part of an escape sequence (or we received
-					// an invalid second character in the sequence). We'll process 
-					// the data in the serial_input variable.
-					characters_into_escape_sequence = 0;
-				}
-			}
+		if(!play_game_pass()) {
+			// Someone wants to play - end the demo game
+			demo_interrupted = 1;
+			break;
 		}
-		if (serial_input == 'n' || serial_input == 'N'){
-			//New Game
-			new_game();
+		// Check if a move finished the level - and restart if so
+		if(is_level_complete()) {
+			// This will wait until a button is pushed
+			PT_SPAWN(pt, &level_complete_pt, handle_level_complete(&level_complete_pt));
+			initialise_next_level();	// (Restarts the game time from now)
+			// Don't count the time spent waiting
+			last_loop_start_time = get_timer1_count();
 		}
-		
-		if(serial_input == 'p' || serial_input == 'P') {
-			// Unimplemented feature - pause/unpause the game until 'p' or 'P' is
-			// pressed again
-			paused = !paused ; 
-			if (paused) {
-				move_cursor(37, 4) ;
-				printf("Pause ||") ;
-				}else {
-				move_cursor(37,4) ;
-				printf("             ");
+		PT_YIELD(pt);
+	}
+	// We get here if the game is over.
+	game_running = 0;
+	PT_END(pt);
+}
+
+// Deal with any input and do anything else the game needs on this pass of
+// the main loop. Returns 0 if a demo game should end (someone has pushed a
+// button), 1 otherwise.
+int8_t play_game_pass(void) {
+	static uint8_t characters_into_escape_sequence;
+	int8_t button, direction; 
+	char serial_input, escape_sequence_char;
+	uint16_t loop_start_time;
+	
+	// Keep track of the longest time between passes of this loop
+	loop_start_time = get_timer1_count();
+	if((uint16_t)(loop_start_time - last_loop_start_time) > max_loop_time) {
+		max_loop_time = loop_start_time - last_loop_start_time;
+	}
+	last_loop_start_time = loop_start_time;
+	
+	// Check for input - which could be a button push or serial input.
+	// Serial input may be part of an escape sequence, e.g. ESC [ D
+	// is a left cursor key press. At most one of the following three
+	// variables will be set to a value other than -1 if input is available.
+	// (We don't initalise button to -1 since button_pushed() will return -1
+	// if no button pushes are waiting to be returned.)
+	// Button pushes take priority over serial input. If there are both then
+	// we'll retrieve the serial input the next time through this loop
+	// (The joystick is read by its own task - see joystick_task().)
+	serial_input = -1;
+	escape_sequence_char = -1;
+	button = button_pushed();
+	
+	if(autopilot_mode == AUTOPILOT_DEMO && button != NO_BUTTON_PUSHED) {
+		return 0;
+	}
+	if(woken && (button != NO_BUTTON_PUSHED || serial_input_available())) {
+		// Keep track of how long it takes to get to input that woke us up
+		if((uint16_t)(get_timer1_count() - wake_time) > max_wake_latency) {
+			max_wake_latency = get_timer1_count() - wake_time;
+		}
+	}
+	
+	if(button == NO_BUTTON_PUSHED) {
+		// No push button was pushed, see if there is any serial input
+		if(serial_input_available()) {
+			// Serial data was available - read the data from standard input
+			serial_input = fgetc(stdin);
+			// Check if the character is part of an escape sequence
+			if(characters_into_escape_sequence == 0 && serial_input == ESCAPE_CHAR) {
+				// We've hit the first character in an escape sequence (escape)
+				characters_into_escape_sequence++;
+				serial_input = -1; // Don't further process this character
+			} else if(characters_into_escape_sequence == 1 && serial_input == '[') {
+				// We've hit the second character in an escape sequence
+				characters_into_escape_sequence++;
+				serial_input = -1; // Don't further process this character
+			} else if(characters_into_escape_sequence == 2) {
+				// Third (and last) character in the escape sequence
+				escape_sequence_char = serial_input;
+				serial_input = -1;  // Don't further process this character - we
+									// deal with it as part of the escape sequence
+				characters_into_escape_sequence = 0;
+			} else {
+				// Character was not part of an escape sequence (or we received
+				// an invalid second character in the sequence). We'll process 
+				// the data in the serial_input variable.
+				characters_into_escape_sequence = 0;
 			}
 		}
-		
-		// Process the input. 
-		if(!paused){
-			joystick = joystick_dir(); //Get joystick direction. 
-		if(button==3 || escape_sequence_char=='A' || joystick == 3) {
+	}
+	if (serial_input == 'n' || serial_input == 'N'){
+		//New Game
+		stop_replay();
+		new_game();
+		// Don't count the time taken to redraw the screen
+		last_loop_start_time = get_timer1_count();
+	}
+	
+	if(serial_input == 'l' || serial_input == 'L') {
+		// Report loop timing statistics
+		report_loop_stats();
+		report_ledmatrix_stats();
+		report_autopilot_stats();
+	}
+	
+	if(serial_input == 'i' || serial_input == 'I') {
+		// Turn sleeping when idle on or off
+		sleep_enabled = !sleep_enabled;
+		report_task_stats();
+	}
+	
+	if(serial_input == '+' || serial_input == '-') {
+		// Change how fast text scrolls across the LED matrix
+		change_scroll_period(serial_input == '+' ? -1 : 1);
+	}
+	
+	if(serial_input == 't' || serial_input == 'T') {
+		// Report how the tasks are keeping to time
+		report_task_stats();
+	}
+	
+	if(serial_input == 'w' || serial_input == 'W') {
+		// Report how much RAM is free and how deep the stack has been
+		report_ram_usage();
+	}
+	
+	if(serial_input == 'm' || serial_input == 'M') {
+		// Report the size of this level's maze and how long it took to decode
+		report_maze_stats();
+	}
+	
+#if RANDOM_COST_BENCH
+	if(serial_input == 'r' || serial_input == 'R') {
+		// Report how long it takes to generate random numbers
+		report_random_cost();
+	}
+#endif
+	
+	if(serial_input == 'q' || serial_input == 'Q') {
+		// Turn the sound off or on
+		set_sound_muted(!is_sound_muted());
+		report_sound_stats();
+	}
+	
+	if(serial_input == 'd' || serial_input == 'D') {
+		// Dump the input log (below the game field) so it can be saved
+		move_cursor(1, FIELD_HEIGHT + 2);
+		send_input_log();
+	}
+	
+	if(serial_input == 'u' || serial_input == 'U') {
+		// Upload an input log (as output by 'd') and replay it
+		move_cursor(1, FIELD_HEIGHT + 2);
+		printf_P(PSTR("Send input log, ending with '.'"));
+		if(receive_input_log() == 0) {
+			printf_P(PSTR(" - rejected"));
+		}
+		(void)start_replay();
+		show_replay_status();
+		last_loop_start_time = get_timer1_count();
+	}
+	
+	if(serial_input == 'v' || serial_input == 'V') {
+		// Start or stop replaying the input log
+		if(is_replaying()) {
+			stop_replay();
+		} else {
+			(void)start_replay();
+		}
+		show_replay_status();
+		last_loop_start_time = get_timer1_count();
+	}
+	
+	if(serial_input == 'f' || serial_input == 'F') {
+		// Skip the replay forward to the next keyframe
+		(void)skip_to_next_keyframe();
+		last_loop_start_time = get_timer1_count();
+	}
+	
+	if(serial_input == 'a' || serial_input == 'A') {
+		// Turn the autopilot on or off
+		set_autopilot_mode(autopilot_mode == AUTOPILOT_OFF ? AUTOPILOT_ON : AUTOPILOT_OFF);
+	}
+	
+	if(serial_input == 'z' || serial_input == 'Z') {
+		// Start or stop running the game flat out
+		set_autopilot_mode(autopilot_mode == AUTOPILOT_SOAK ? AUTOPILOT_OFF : AUTOPILOT_SOAK);
+		last_loop_start_time = get_timer1_count();
+	}
+	
+	if(serial_input == 'h' || serial_input == 'H') {
+		// Choose normal or hard ghosts for the next game
+		ghost_difficulty_selected = !ghost_difficulty_selected;
+		show_ghost_difficulty();
+	}
+	
+	if(serial_input == 's' || serial_input == 'S') {
+		// Output a snapshot of the game (below the game field)
+		move_cursor(1, FIELD_HEIGHT + 2);
+		send_snapshot();
+	}
+	
+	if(serial_input == 'g' || serial_input == 'G') {
+		// Get a snapshot (as output by 's') and carry on from there
+		move_cursor(1, FIELD_HEIGHT + 2);
+		printf_P(PSTR("Send snapshot, ending with '.'"));
+		if(!receive_snapshot()) {
+			printf_P(PSTR(" - rejected"));
+		}
+		show_replay_status();
+		last_loop_start_time = get_timer1_count();
+	}
+	
+	if((serial_input == 'p' || serial_input == 'P') && !is_replaying()) {
+		// Pause/unpause the game until 'p' or 'P' is pressed again
+		set_paused(!paused);
+	}
+	
+	if(is_replaying()) {
+		// Input comes from the log rather than the player. (Pauses are
+		// replayed too, so this is done even when paused.)
+		replay_inputs();
+		show_replay_status();
+	}
+	
+	// Process the input. 
+	if(!paused) {
+		direction = -1;
+		if(button==3 || escape_sequence_char=='A') {
 			// Button 3 pressed OR left cursor key escape sequence completed 
 			// Attempt to move left
-			change_pacman_direction(DIRN_LEFT);
-		} else if(button==2 || escape_sequence_char=='W'|| joystick == 1) {
+			direction = DIRN_LEFT;
+		} else if(button==2 || escape_sequence_char=='W') {
 			// Button 2 pressed or up cursor key escape sequence completed
 			// Attempt to move up 
-			change_pacman_direction(DIRN_UP);
-		} else if(button==1 || escape_sequence_char=='S' || joystick == 2) {
+			direction = DIRN_UP;
+		} else if(button==1 || escape_sequence_char=='S') {
 			// Button 1 pressed OR down cursor key escape sequence completed
 			// Attempt to move down
-			change_pacman_direction(DIRN_DOWN); 
-		} else if(button==0 || escape_sequence_char=='D'|| joystick == 4 ) {
+			direction = DIRN_DOWN;
+		} else if(button==0 || escape_sequence_char=='D') {
 			// Button 0 pressed OR right cursor key escape sequence completed 
 			// Attempt to move right
-			change_pacman_direction(DIRN_RIGHT);
-		}  
-		
-		
-		// else - invalid input or we're part way through an escape sequence -
-		// do nothing
-		
-		current_time = get_current_time();
-		if(!is_game_over() && current_time >= pacman_last_move_time + 400) {
-			// 400ms (0.4 second) has passed since the last time we moved 
-			// the pac-man - move it.
-			move_pacman();
-			pacman_last_move_time = current_time;
-			
-			// Check if the move finished the level - and restart if so
-			if(is_level_complete()) {
-				handle_level_complete();	// This will pause until a button is pushed
-				initialise_game_level();
-				// Update our timers since we have a pause above
-				pacman_last_move_time = ghost_last_move_time = get_current_time();
-			}
-		}
-		if(!is_game_over() && current_time >= ghost_last_move_time + 420) {
-			// 500ms (0.5 second) has passed since the last time we moved the
-			// ghosts - move them
-			move_ghost(0);
-			ghost_last_move_time = current_time;
+			direction = DIRN_RIGHT;
 		}
-		if (!is_game_over() && current_time >= ghost_last_move_time1 + 450){
-			move_ghost(1); 
-			ghost_last_move_time1 = current_time; 
+		// else - invalid input or we're part way through an escape 
+		// sequence - do nothing
+		if(autopilot_mode == AUTOPILOT_OFF) {
+			steer_pacman(direction);
 		}
-		if (!is_game_over() && current_time >= ghost_last_move_time2 + 500){
-			move_ghost(2); 
-			ghost_last_move_time2 = current_time; 
+		
+		// Use some spare time to work out the ghosts' next moves
+		plan_ghost_moves(GHOST_PLAN_BUDGET);
+	}
+	// Draw anything else that has changed (e.g. a new level or a restored
+	// game - even while paused)
+	update_display();
+	return 1;
+}
+
+// Change the pac-man's direction (direction is -1 for no change) unless a
+// replay is running. Direction changes are recorded so they can be 
+// replayed. (Steering the way it is already going changes nothing, so 
+// isn't recorded - otherwise holding the joystick would fill the log.)
+void steer_pacman(int8_t direction) {
+	if(direction >= 0 && !is_replaying() && direction != get_pacman_direction() &&
+			change_pacman_direction(direction)) {
+		log_direction_change(direction);
+	}
+}
+
+// Add the tasks run by the play_game() loop. Their deadlines are all reset
+// at the start of each game.
+void initialise_tasks(void) {
+	game_task_num = add_task(game_task, PSTR("Game"), GAME_TASK_PERIOD, 0);
+	(void)add_task(joystick_task, PSTR("Joystick"), JOYSTICK_TASK_PERIOD, 1);
+	(void)add_task(display_lives, PSTR("Lives"), LIVES_TASK_PERIOD, 2);
+	scroll_task_num = add_task(scroll_task, PSTR("Scroll"), scroll_period, 3);
+	// (Text keeps scrolling while the game is paused)
+	set_task_wall_clock(scroll_task_num);
+}
+
+// Task to scroll any text on the LED matrix by a pixel. The game map is
+// shown again once the text has gone.
+void scroll_task(void) {
+	if(is_text_scrolling() && !scroll_display() && game_running) {
+		show_map();
+	}
+}
+
+// Make text scroll slower (change > 0) or faster (change < 0)
+void change_scroll_period(int8_t change) {
+	if(change > 0 && scroll_period < MAX_SCROLL_PERIOD) {
+		scroll_period += SCROLL_PERIOD_STEP;
+	} else if(change < 0 && scroll_period > MIN_SCROLL_PERIOD) {
+		scroll_period -= SCROLL_PERIOD_STEP;
+	}
+	set_task_period(scroll_task_num, scroll_period);
+	report_ledmatrix_stats();
+}
+
+// Task to bring the game up to date with the clock, one millisecond at a 
+// time. If we're running late this catches up on all the missed time in 
+// order, so the game plays out the same however late we are.
+void game_task(void) {
+	uint32_t current_time;
+	
+	if(!game_running || is_level_complete()) {
+		// Nothing to do (play_game() waits for the next level to start)
+		return;
+	}
+	
+	if(autopilot_mode != AUTOPILOT_OFF) {
+		// Let the autopilot keep up with the game
+		steer_pacman(autopilot_direction());
+	}
+	
+	current_time = get_current_time();
+	if(autopilot_mode == AUTOPILOT_SOAK) {
+		// Run the game flat out rather than following the clock
+		current_time = get_game_time() + SOAK_TICKS_PER_PASS;
+		soak_ticks += SOAK_TICKS_PER_PASS;
+	} else if((uint16_t)(current_time - get_game_time()) > max_catch_up) {
+		max_catch_up = current_time - get_game_time();
+	}
+	while(!is_game_over() && !paused && get_game_time() != current_time) {
+		if(is_replaying()) {
+			// Apply whatever was recorded at this tick first
+			replay_inputs();
+			if(paused || get_game_time() == current_time) {
+				break;
+			}
 		}
-		if (!is_game_over() && current_time >= ghost_last_move_time3 + 570){
-			move_ghost(3); 
-			ghost_last_move_time3 = current_time; 
+		advance_game_time();
+		update_display();
+		if(is_level_complete()) {
+			// (play_game() starts the next level)
+			break;
 		}
-		
+		log_keyframe_if_due();
+	}
+}
+
+// Task to read the joystick and steer the pac-man with it
+void joystick_task(void) {
+	int8_t joystick, direction = -1;
+	if(!game_running || paused) {
+		return;
+	}
+	joystick = joystick_dir();
+	if(joystick == 3) {
+		direction = DIRN_LEFT;
+	} else if(joystick == 1) {
+		direction = DIRN_UP;
+	} else if(joystick == 2) {
+		direction = DIRN_DOWN;
+	} else if(joystick == 4) {
+		direction = DIRN_RIGHT;
+	}
+	if(autopilot_mode == AUTOPILOT_OFF) {
+		steer_pacman(direction);
 	}
-	// We get here if the game is over.
 }
-		} //if not paused. 
 
-void handle_level_complete(void) {
-	move_cursor(35,10);
+PT_THREAD(handle_level_complete(Protothread* pt)) {
+	char level_message[MAX_SCROLLING_TEXT_LENGTH + 1];
+	
+	PT_BEGIN(pt);
+	move_cursor(STATUS_X - 2,10);
 	printf_P(PSTR("Level complete"));
-	move_cursor(35,11);
+	move_cursor(STATUS_X - 2,11);
 	printf_P(PSTR("Push a button or key to continue"));
+	// Show the number of the next level on the LED matrix (numbered 
+	// from 1 here)
+	snprintf_P(level_message, sizeof(level_message), PSTR("LEVEL %u"), get_level() + 2);
+	(void)queue_scrolling_text(level_message, COLOUR_YELLOW);
 	// Clear any characters in the serial input buffer - to make
 	// sure we only use key presses from now on.
 	clear_serial_input_buffer();
-	while(button_pushed() == NO_BUTTON_PUSHED && !serial_input_available()) {
-		; // wait
-	}
+	// (A replay or the autopilot in a demo or soak test doesn't wait - the 
+	// game time doesn't move on while we wait)
+	PT_WAIT_UNTIL(pt, is_replaying() || autopilot_mode >= AUTOPILOT_DEMO || 
+			button_pushed() != NO_BUTTON_PUSHED || serial_input_available());
 	// Throw away any characters in the serial input buffer
 	clear_serial_input_buffer();
-
+	PT_END(pt);
 }
 
-void handle_game_over(void) {
+PT_THREAD(handle_game_over(Protothread* pt)) {
+	// (The most digits a uint32_t has)
+	char score_digits[10 + 1];
+	
+	PT_BEGIN(pt);
 	display_lives(); 
-	move_cursor(35,14);
+	move_cursor(STATUS_X - 2,14);
 	printf_P(PSTR("GAME OVER"));
-	move_cursor(35,16);
+	move_cursor(STATUS_X - 2,16);
 	printf_P(PSTR("Press a button to start again"));
-	while(button_pushed() == NO_BUTTON_PUSHED) {
-		; // wait
+	// Keep the score if it's one of the best. (Games played by the
+	// autopilot or replayed don't count.)
+	if(autopilot_mode == AUTOPILOT_OFF && !is_replaying()) {
+		(void)add_highscore(get_score());
 	}
-	
+	// Show the game is over on the LED matrix too, with the score. (The
+	// number is queued on its own so that none of it is cut off.)
+	(void)queue_scrolling_text_P(PSTR("GAME OVER"), COLOUR_RED);
+	(void)queue_scrolling_text_P(PSTR("SCORE "), COLOUR_ORANGE);
+	snprintf_P(score_digits, sizeof(score_digits), PSTR("%lu"), get_score());
+	(void)queue_scrolling_text(score_digits, COLOUR_ORANGE);
+	if(is_replaying() && next_replay_input() == INPUT_LOG_NEW_GAME) {
+		// The replay goes straight on to the next game that was recorded
+		set_random_state(get_replay_random_state());
+		set_ghost_difficulty(get_replay_ghost_difficulty());
+		PT_EXIT(pt);
+	}
+	show_replay_status();
+	if(autopilot_mode == AUTOPILOT_SOAK) {
+		// Straight on to the next game
+		PT_EXIT(pt);
+	}
+	PT_WAIT_UNTIL(pt, button_pushed() != NO_BUTTON_PUSHED);
+	PT_END(pt);
 }
 
 //Display lives to LED0,1,2
@@ -326,4 +814,238 @@ void set_disp_lives(uint8_t num){
 
 uint8_t is_paused(void){
 	return paused;
-}
\ No newline at end of file
+}
+
+void set_paused(uint8_t pause) {
+	if (pause != paused) {
+		log_pause();
+	}
+	paused = pause ; 
+	set_clock_paused(pause);
+	show_pause_status();
+}
+
+void show_pause_status(void) {
+	if (paused) {
+		move_cursor(STATUS_X, 4) ;
+		printf_P(PSTR("Pause ||"));
+	}else {
+		move_cursor(STATUS_X,4) ;
+		printf_P(PSTR("             "));
+	}
+}
+
+// Draw whatever has changed in the game, on the terminal and on the LED
+// matrix, and play the sounds for it. If the terminal display had to 
+// redraw everything (which clears the screen) then our own status is 
+// shown again.
+void update_display(void) {
+	GameEvent event;
+	int8_t redrawn = 0;
+	while(get_game_event(&event)) {
+		redrawn |= display_game_event(&event);
+		show_game_event_on_map(&event);
+		play_game_event_sound(&event);
+	}
+	if(redrawn) {
+		show_pause_status();
+		replay_status_shown = 0;
+		show_replay_status();
+		show_autopilot_status();
+		show_ghost_difficulty();
+	}
+}
+
+// Change who is playing (see autopilot_mode above)
+void set_autopilot_mode(uint8_t mode) {
+	if(mode == AUTOPILOT_SOAK && autopilot_mode != AUTOPILOT_SOAK) {
+		soak_start_time = get_current_time();
+		soak_ticks = 0;
+	} else if(mode != AUTOPILOT_SOAK && autopilot_mode == AUTOPILOT_SOAK) {
+		// The game has got ahead of the clock - carry on from now
+		soak_end_time = get_current_time();
+		set_game_time(soak_end_time);
+		report_autopilot_stats();
+	}
+	// Soak mode moves the game on as often as it can
+	set_task_period(game_task_num, mode == AUTOPILOT_SOAK ? 0 : GAME_TASK_PERIOD);
+	autopilot_mode = mode;
+	show_autopilot_status();
+}
+
+void show_autopilot_status(void) {
+	move_cursor(STATUS_X, 7);
+	if(autopilot_mode == AUTOPILOT_OFF) {
+		printf_P(PSTR("          "));
+	} else if(autopilot_mode == AUTOPILOT_SOAK) {
+		printf_P(PSTR("Soak test "));
+	} else if(autopilot_mode == AUTOPILOT_DEMO) {
+		printf_P(PSTR("Demo      "));
+	} else {
+		printf_P(PSTR("Autopilot "));
+	}
+}
+
+// Show whether the ghosts are hard in this game and what the next game
+// will have if that's different
+void show_ghost_difficulty(void) {
+	move_cursor(STATUS_X, 8);
+	if(get_ghost_difficulty() == ghost_difficulty_selected) {
+		printf_P(ghost_difficulty_selected ? PSTR("Hard ghosts         ") : PSTR("                    "));
+	} else {
+		printf_P(ghost_difficulty_selected ? PSTR("Next game: hard     ") : PSTR("Next game: normal   "));
+	}
+}
+
+// Output how many autopilot searches have been done and the longest one
+// took, and how fast the last soak test ran
+void report_autopilot_stats(void) {
+	uint16_t searches, max_search_time;
+	uint32_t soak_time = (autopilot_mode == AUTOPILOT_SOAK ? get_current_time() : soak_end_time)
+			- soak_start_time;
+	get_autopilot_stats(&searches, &max_search_time);
+	move_cursor(STATUS_X, 23);
+	printf_P(PSTR("Autopilot: %u searches, max %u us (%lu cycles)"), searches,
+			max_search_time, (uint32_t)max_search_time * TIMER1_CYCLES_PER_COUNT);
+	move_cursor(STATUS_X, 24);
+	printf_P(PSTR("Soak: %lu ticks in %lu ms"), soak_ticks, soak_time);
+}
+
+// Apply all the replayed input that is due at the current game tick
+void replay_inputs(void) {
+	int8_t input;
+	while((input = next_replay_input()) != NO_REPLAY_INPUT) {
+		if(input == INPUT_LOG_PAUSE) {
+			set_paused(!paused);
+		} else if(input == INPUT_LOG_NEW_GAME) {
+			set_random_state(get_replay_random_state());
+			set_ghost_difficulty(get_replay_ghost_difficulty());
+			new_game();
+		} else {
+			(void)change_pacman_direction(input);
+		}
+	}
+}
+
+// Show whether a replay is running and how many keyframes it has got wrong
+// (if that has changed since it was last shown)
+void show_replay_status(void) {
+	if(is_replaying() == replay_status_shown && 
+			get_replay_mismatches() == replay_mismatches_shown) {
+		return;
+	}
+	replay_status_shown = is_replaying();
+	replay_mismatches_shown = get_replay_mismatches();
+	move_cursor(STATUS_X, 6);
+	if(replay_status_shown) {
+		printf_P(PSTR("Replay (%u bad)  "), replay_mismatches_shown);
+	} else {
+		printf_P(PSTR("                 "));
+	}
+}
+
+// Output the worst case loop time (in microseconds and clock cycles), how
+// many ghost moves were worked out ahead of time (and the longest one that
+// wasn't took) and how the hard ghosts' searches are doing
+void report_loop_stats(void) {
+	uint16_t hits, misses, max_miss_time;
+	uint16_t searches, max_search_time, max_steps, cut_short, corridor_hits, corridor_misses;
+	get_ghost_plan_stats(&hits, &misses, &max_miss_time);
+	move_cursor(STATUS_X, 18);
+	printf_P(PSTR("Max loop: %5u us (%lu cycles)"), max_loop_time,
+			(uint32_t)max_loop_time * TIMER1_CYCLES_PER_COUNT);
+	move_cursor(STATUS_X, 19);
+	printf_P(PSTR("Ghost moves planned: %u/%u, max unplanned %u us"), hits, hits + misses,
+			max_miss_time);
+	move_cursor(STATUS_X, 21);
+	printf_P(PSTR("Max catch up: %5u ms"), max_catch_up);
+	get_ghost_search_stats(&searches, &max_search_time, &max_steps, &cut_short,
+			&corridor_hits, &corridor_misses);
+	move_cursor(STATUS_X, 12);
+	printf_P(PSTR("Hard ghosts: %u searches, max %u us, corridors known %u/%u"), 
+			searches, max_search_time, corridor_hits, corridor_hits + corridor_misses);
+	move_cursor(STATUS_X, 13);
+	printf_P(PSTR("Hard ghost search: max %u steps (limit %u), %u cut short"),
+			max_steps, MAX_SEARCH_STEPS, cut_short);
+}
+
+// Output how many bytes have been sent to the LED matrix, in the last frame
+// (everything sent to bring it up to date after a change), the largest
+// frame and on average, and how fast text is scrolled
+void report_ledmatrix_stats(void) {
+	uint32_t frames, bytes;
+	uint16_t last_bytes, max_bytes;
+	get_ledmatrix_stats(&frames, &last_bytes, &max_bytes, &bytes);
+	move_cursor(STATUS_X, 17);
+	printf_P(PSTR("LED matrix: %4u bytes/frame (max %4u, mean %4lu), scroll %3u ms"), 
+			last_bytes, max_bytes, frames ? bytes / frames : 0, scroll_period);
+}
+
+// Output the size of the compressed maze for this level and the time
+// it took to decode it
+void report_maze_stats(void) {
+	uint16_t encoded_size, decode_time;
+	get_maze_stats(&encoded_size, &decode_time);
+	move_cursor(STATUS_X, 20);
+	printf_P(PSTR("Maze: %u bytes, decoded in %u us"), encoded_size, decode_time);
+}
+
+#if RANDOM_COST_BENCH
+// Output the number of clock cycles each call of the game's random number
+// generator takes compared with the C library random()
+void report_random_cost(void) {
+	uint16_t game_random_time, libc_random_time;
+	measure_random_cost(&game_random_time, &libc_random_time);
+	move_cursor(STATUS_X, 22);
+	printf_P(PSTR("Random: %u cycles (random(): %u)"), 
+			(uint16_t)((uint32_t)game_random_time * TIMER1_CYCLES_PER_COUNT / RANDOM_COST_CALLS),
+			(uint16_t)((uint32_t)libc_random_time * TIMER1_CYCLES_PER_COUNT / RANDOM_COST_CALLS));
+}
+#endif /* RANDOM_COST_BENCH */
+
+// Output whether the sound is on and how many clock cycles the sound
+// interrupt handler takes (just counting down a note, and starting a new 
+// note)
+void report_sound_stats(void) {
+	uint16_t count_time, note_time;
+	measure_sound_cost(&count_time, &note_time);
+	move_cursor(STATUS_X, 15);
+	printf_P(PSTR("Sound %-3S: interrupt %3u cycles (%3u for a new note)"),
+			is_sound_muted() ? PSTR("off") : PSTR("on"),
+			(uint16_t)((uint32_t)count_time * TIMER1_CYCLES_PER_COUNT / SOUND_COST_CALLS),
+			(uint16_t)((uint32_t)note_time * TIMER1_CYCLES_PER_COUNT / SOUND_COST_CALLS));
+}
+
+// Output each task's period, how many times it has run, the latest it has 
+// been run, the number of runs it has missed and the longest it has taken 
+// (below the autopilot stats). Also output the percentage of the time 
+// since the game started the CPU has been asleep and the longest it has
+// taken to respond to input after waking up.
+void report_task_stats(void) {
+	TaskStats stats;
+	// (in 1/100ths of the time, to get a percentage)
+	uint32_t elapsed_time = (get_timestamp() - sleep_stats_start_time) / 100;
+	move_cursor(STATUS_X, 25);
+	printf_P(PSTR("Sleep %-3S: %3u%% asleep, wake to input max %5u us, %lu timer interrupts"),
+			sleep_enabled ? PSTR("on") : PSTR("off"),
+			elapsed_time ? (uint16_t)(sleep_time / elapsed_time) : 0,
+			max_wake_latency, get_timer0_interrupts() - interrupts_at_start);
+	for(uint8_t i = 0; i < get_num_tasks(); i++) {
+		get_task_stats(i, &stats);
+		move_cursor(STATUS_X, 26 + i);
+		printf_P(stats.name);
+		move_cursor(STATUS_X + 9, 26 + i);
+		printf_P(PSTR("%3u ms: %7lu runs, late %3u ms, missed %5u, max %5u us"),
+				stats.period, stats.runs, stats.max_late, stats.missed, stats.max_run_time);
+	}
+}
+
+// Output how much RAM the static variables take, how much is free now and
+// how much has never been used by the stack (and the most it has used), 
+// below the task stats
+void report_ram_usage(void) {
+	uint16_t unused = get_unused_ram();
+	move_cursor(STATUS_X, 26 + MAX_TASKS);
+	printf_P(PSTR("RAM: %4u bytes static, %4u free, %4u never used (stack max %4u)"),
+			get_static_ram_size(), get_free_ram(), unused, get_max_stack_size());
+}
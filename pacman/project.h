@@ -13,5 +13,9 @@
 //Game pause status 
 uint8_t is_paused(void) ; 
 
+// Pause (1) or unpause (0) the game, showing the pause status. A change is
+// recorded in the input log.
+void set_paused(uint8_t pause) ;
+
 
 #endif /* PROJECT_H_ */
\ No newline at end of file
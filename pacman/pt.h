@@ -0,0 +1,84 @@
+/*
+ * pt.h
+ *
+ * Protothreads (after Adam Dunkels' protothreads library). A protothread is
+ * a function which can wait for something (e.g. a button push) part way
+ * through by returning, and carries on from where it was waiting the next
+ * time it is called. This lets the main loop keep doing other things while
+ * it waits. The only state kept is where the function was waiting (a
+ * Protothread - 2 bytes), so:
+ *	- local variables are NOT kept across a wait - use static variables for
+ *	  anything needed after a wait;
+ *	- a protothread must not use a switch statement itself (the waits are
+ *	  cases of a switch statement on where it was waiting), and there can
+ *	  only be one wait (or yield or spawn) on each line.
+ *
+ * A protothread looks like:
+ *		PT_THREAD(flash(Protothread* pt)) {
+ *			PT_BEGIN(pt);
+ *			while(1) {
+ *				led_on();
+ *				PT_WAIT_UNTIL(pt, button_pushed() != NO_BUTTON_PUSHED);
+ *				led_off();
+ *				PT_YIELD(pt);
+ *			}
+ *			PT_END(pt);
+ *		}
+ * and is called repeatedly (after PT_INIT()) until it returns PT_EXITED or
+ * PT_ENDED, e.g. from the main loop or from another protothread with
+ * PT_SPAWN().
+ */
+
+#ifndef PT_H_
+#define PT_H_
+
+#include <stdint.h>
+
+typedef struct {
+	uint16_t lc;		// Line number it is waiting at (0 for the start)
+} Protothread;
+
+// Values returned by a protothread
+#define PT_WAITING 0
+#define PT_YIELDED 1
+#define PT_EXITED 2
+#define PT_ENDED 3
+
+// Declare a protothread, e.g. PT_THREAD(name(Protothread* pt))
+#define PT_THREAD(name_args) int8_t name_args
+
+// Start (or restart) a protothread from the beginning
+#define PT_INIT(pt) ((pt)->lc = 0)
+
+// Start and end the body of a protothread. Reaching the end returns
+// PT_ENDED and leaves it ready to start from the beginning again.
+#define PT_BEGIN(pt) { uint8_t pt_yield_flag = 1; (void)pt_yield_flag; \
+		switch((pt)->lc) { case 0:
+#define PT_END(pt) } pt_yield_flag = 0; PT_INIT(pt); return PT_ENDED; }
+
+// Wait until (or while) condition is true. The condition is checked
+// straight away and then each time the protothread is called.
+#define PT_WAIT_UNTIL(pt, condition) do { \
+		(pt)->lc = __LINE__; case __LINE__: \
+		if(!(condition)) { return PT_WAITING; } } while(0)
+#define PT_WAIT_WHILE(pt, condition) PT_WAIT_UNTIL((pt), !(condition))
+
+// Returns 1 if a protothread (the value it returned) is still running
+#define PT_SCHEDULE(f) ((f) < PT_EXITED)
+
+// Start the child protothread and wait until it has finished. thread is
+// the call of it, e.g. PT_SPAWN(pt, &child_pt, child(&child_pt)).
+#define PT_WAIT_THREAD(pt, thread) PT_WAIT_WHILE((pt), PT_SCHEDULE(thread))
+#define PT_SPAWN(pt, child, thread) do { \
+		PT_INIT((child)); PT_WAIT_THREAD((pt), (thread)); } while(0)
+
+// Return to the caller once, carrying on from here the next time
+#define PT_YIELD(pt) do { \
+		pt_yield_flag = 0; \
+		(pt)->lc = __LINE__; case __LINE__: \
+		if(pt_yield_flag == 0) { return PT_YIELDED; } } while(0)
+
+// Stop the protothread (it starts from the beginning if called again)
+#define PT_EXIT(pt) do { PT_INIT(pt); return PT_EXITED; } while(0)
+
+#endif /* PT_H_ */
@@ -0,0 +1,60 @@
+/*
+ * ram_usage.c
+ *
+ * Painting the free RAM at start up and measuring how much of it has
+ * been used - see ram_usage.h
+ */
+
+#include <avr/io.h>
+
+#include "ram_usage.h"
+
+// Set by the linker - the start of .data (the first static variable) and
+// the end of .bss (the byte after the last one)
+extern uint8_t __data_start;
+extern uint8_t _end;
+
+// Paint everything from the end of .bss to the top of RAM. This is run
+// from .init1, just after reset and before anything (even setting up the
+// stack pointer and the zero register) is done, so it can't be compiled C
+// - it is written in assembler and only uses registers. It is never
+// called - the linker puts it into the start up code.
+void paint_stack(void) __attribute__((naked, used, section(".init1")));
+void paint_stack(void) {
+	__asm__ volatile(
+		"	ldi r30, lo8(_end)\n"
+		"	ldi r31, hi8(_end)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(%1)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(%1)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:: "M" (STACK_PAINT), "i" (RAMEND));
+}
+
+uint16_t get_static_ram_size(void) {
+	return &_end - &__data_start;
+}
+
+uint16_t get_free_ram(void) {
+	// (The stack pointer points at the next byte to be pushed, which is
+	// still free)
+	return SP - (uint16_t)&_end + 1;
+}
+
+uint16_t get_unused_ram(void) {
+	const uint8_t* p = &_end;
+	// Look up from the bottom for the first byte the stack has written.
+	// (It can't be above the stack pointer, which is in use now.)
+	while(p <= (const uint8_t*)SP && *p == STACK_PAINT) {
+		p++;
+	}
+	return p - &_end;
+}
+
+uint16_t get_max_stack_size(void) {
+	return RAMEND - (uint16_t)&_end + 1 - get_unused_ram();
+}
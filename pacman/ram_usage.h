@@ -0,0 +1,38 @@
+/*
+ * ram_usage.h
+ *
+ * How much of the RAM (2K) is being used. The static variables (.data and
+ * .bss) are at the bottom of RAM and the stack grows down from the top.
+ * Nothing uses malloc(), so everything in between is free.
+ *
+ * Before main() is called the free RAM is filled with STACK_PAINT
+ * ("painted"). The stack overwrites the paint as it grows, so the lowest
+ * byte no longer holding it shows the deepest the stack has ever been -
+ * including inside library functions like printf() (whose stack use isn't
+ * known otherwise) and interrupt handlers. This tells us how much room
+ * there is for bigger buffers. (A stack byte that happens to hold the
+ * paint value could make the stack look a byte or two smaller than it
+ * was, but only if it is the deepest byte used.)
+ */
+
+#ifndef RAM_USAGE_H_
+#define RAM_USAGE_H_
+
+#include <stdint.h>
+
+// Value the free RAM is painted with at start up
+#define STACK_PAINT 0xC5
+
+// Return the number of bytes used by static variables (.data and .bss)
+uint16_t get_static_ram_size(void);
+
+// Return the number of bytes between the static variables and the stack
+// right now
+uint16_t get_free_ram(void);
+
+// Return the number of bytes the stack has never reached (the free RAM
+// left at the worst point so far), and the most the stack has ever used
+uint16_t get_unused_ram(void);
+uint16_t get_max_stack_size(void);
+
+#endif /* RAM_USAGE_H_ */
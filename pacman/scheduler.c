@@ -0,0 +1,169 @@
+/*
+ * scheduler.c
+ *
+ * Fixed period cooperative tasks - see scheduler.h
+ */
+
+#include <string.h>
+
+#include "scheduler.h"
+#include "timer0.h"
+#include "timer1.h"
+
+typedef struct {
+	TaskFunction function;
+	uint16_t phase;
+	uint8_t wall_clock;		// Set if run by the wall clock, not the game clock
+	uint32_t deadline;		// Time (ms, on its clock) it is next due
+	TaskStats stats;
+} Task;
+
+static Task tasks[MAX_TASKS];
+static uint8_t num_tasks;
+
+// Time (wall clock) asked for by request_wakeup(), if wakeup_requested is
+// set
+static uint8_t wakeup_requested;
+static uint32_t wakeup_time;
+
+// Return the time now on the clock the given task is run by
+static uint32_t task_clock(const Task* task) {
+	return task->wall_clock ? get_wall_time() : get_current_time();
+}
+
+int8_t add_task(TaskFunction function, const char* name, uint16_t period, uint16_t phase) {
+	Task* task;
+	if(num_tasks == MAX_TASKS) {
+		return -1;
+	}
+	task = &tasks[num_tasks];
+	task->function = function;
+	task->phase = phase;
+	task->wall_clock = 0;
+	task->deadline = get_current_time() + phase;
+	memset(&task->stats, 0, sizeof(TaskStats));
+	task->stats.name = name;
+	task->stats.period = period;
+	return num_tasks++;
+}
+
+void set_task_wall_clock(int8_t tasknum) {
+	tasks[tasknum].wall_clock = 1;
+	tasks[tasknum].deadline = get_wall_time() + tasks[tasknum].phase;
+}
+
+void set_task_period(int8_t tasknum, uint16_t period) {
+	tasks[tasknum].stats.period = period;
+	tasks[tasknum].deadline = task_clock(&tasks[tasknum]);
+}
+
+void run_due_tasks(void) {
+	Task* task;
+	uint32_t late;
+	uint16_t start_time, run_time, period;
+	for(uint8_t i = 0; i < num_tasks; i++) {
+		task = &tasks[i];
+		// (The difference is taken as signed so that this still works when
+		// the clock wraps around)
+		late = task_clock(task) - task->deadline;
+		if((int32_t)late < 0) {
+			continue;
+		}
+		start_time = get_timer1_count();
+		task->function();
+		run_time = get_timer1_count() - start_time;
+
+		task->stats.runs++;
+		if(run_time > task->stats.max_run_time) {
+			task->stats.max_run_time = run_time;
+		}
+		period = task->stats.period;
+		if(period == 0) {
+			// Run every time - there's no deadline to be late for
+			continue;
+		}
+		if(late > task->stats.max_late) {
+			task->stats.max_late = (late > UINT16_MAX ? UINT16_MAX : late);
+		}
+		task->deadline += period;
+		if(late >= period) {
+			// Skip the deadlines we've already missed, keeping to the same
+			// phase. (Only happens when running late, so the division is
+			// rarely done.)
+			late /= period;
+			task->deadline += late * period;
+			task->stats.missed += late;
+		}
+	}
+}
+
+uint8_t is_task_due(void) {
+	for(uint8_t i = 0; i < num_tasks; i++) {
+		if((int32_t)(task_clock(&tasks[i]) - tasks[i].deadline) >= 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+uint32_t get_next_deadline(void) {
+	uint32_t now = get_wall_time();
+	uint32_t task_now;
+	// Work out how long until each deadline (on its own clock) so the 
+	// clock wrapping around doesn't matter
+	uint32_t time_to_next = INT32_MAX;
+	if(wakeup_requested) {
+		if((int32_t)(wakeup_time - now) > 0) {
+			time_to_next = wakeup_time - now;
+		} else {
+			wakeup_requested = 0;
+		}
+	}
+	for(uint8_t i = 0; i < num_tasks; i++) {
+		if(!tasks[i].wall_clock && is_clock_paused()) {
+			// Not due until the game clock starts again
+			continue;
+		}
+		task_now = task_clock(&tasks[i]);
+		if((int32_t)(tasks[i].deadline - task_now) <= 0) {
+			return now;
+		}
+		if(tasks[i].deadline - task_now < time_to_next) {
+			time_to_next = tasks[i].deadline - task_now;
+		}
+	}
+	return now + time_to_next;
+}
+
+void request_wakeup(uint32_t time) {
+	uint32_t now = get_wall_time();
+	// (An earlier request which has already passed is replaced)
+	if(!wakeup_requested || (int32_t)(wakeup_time - now) <= 0 ||
+			(int32_t)(time - now) < (int32_t)(wakeup_time - now)) {
+		wakeup_time = time;
+	}
+	wakeup_requested = 1;
+}
+
+void restart_tasks(void) {
+	for(uint8_t i = 0; i < num_tasks; i++) {
+		tasks[i].deadline = task_clock(&tasks[i]) + tasks[i].phase;
+	}
+}
+
+void clear_task_stats(void) {
+	for(uint8_t i = 0; i < num_tasks; i++) {
+		tasks[i].stats.runs = 0;
+		tasks[i].stats.max_late = 0;
+		tasks[i].stats.missed = 0;
+		tasks[i].stats.max_run_time = 0;
+	}
+}
+
+uint8_t get_num_tasks(void) {
+	return num_tasks;
+}
+
+void get_task_stats(int8_t tasknum, TaskStats* stats) {
+	*stats = tasks[tasknum].stats;
+}
@@ -0,0 +1,86 @@
+/*
+ * scheduler.h
+ *
+ * Runs the things the main loop has to do regularly (e.g. read the
+ * joystick, move the game on) as tasks, each at its own fixed period. A
+ * task is run by run_due_tasks() once the clock (timer 0) reaches its
+ * deadline, and its next deadline is then one period on from the last
+ * deadline - not from when it actually ran - so running late doesn't make
+ * it drift. A task that is more than a whole period late skips the runs it
+ * missed rather than running several times to catch up (a task that has to
+ * catch up, like moving the game on, can do that itself). Tasks run by the
+ * game clock (see timer0.h) stop while the game is paused; a task can be
+ * put on the wall clock instead to carry on.
+ *
+ * Tasks are cooperative: each one runs to completion, so one that takes a
+ * long time holds the others up. How late each task has been run and how
+ * long it takes are kept so this can be checked.
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdint.h>
+
+// Most tasks that can be added
+#define MAX_TASKS 6
+
+typedef void (*TaskFunction)(void);
+
+typedef struct {
+	const char* name;		// (in program memory)
+	uint16_t period;		// ms
+	uint32_t runs;
+	uint16_t max_late;		// Latest (ms after its deadline) it has been run
+	uint16_t missed;		// Number of deadlines skipped
+	uint16_t max_run_time;	// Longest run (timer 1 counts, i.e. microseconds)
+} TaskStats;
+
+// Add a task which calls function every period milliseconds, the first time
+// phase milliseconds from now. (Giving tasks different phases stops them
+// all being due on the same pass of the main loop.) A period of 0 means
+// the task is run on every call to run_due_tasks(). name is a string in
+// program memory (e.g. PSTR("Joystick")) used when reporting the stats.
+// Returns the task number, or -1 if there are already MAX_TASKS tasks.
+int8_t add_task(TaskFunction function, const char* name, uint16_t period, uint16_t phase);
+
+// Run a task by the wall clock rather than the game clock, so it carries on
+// while the game is paused. Its next run is phase milliseconds from now.
+void set_task_wall_clock(int8_t tasknum);
+
+// Change the period of a task. It is next run straight away.
+void set_task_period(int8_t tasknum, uint16_t period);
+
+// Run each task whose deadline has been reached. This should be called on
+// every pass of the main loop.
+void run_due_tasks(void);
+
+// Returns 1 if a task is due to run, 0 if run_due_tasks() would do nothing.
+// (Can be called with interrupts off.)
+uint8_t is_task_due(void);
+
+// Return the wall clock time when the next task is due - or when a wake up
+// has been asked for with request_wakeup(), if that's sooner - e.g. to know 
+// how long we can sleep for. Tasks on the game clock aren't due while it's
+// paused. (Can be called with interrupts off.)
+uint32_t get_next_deadline(void);
+
+// Make sure get_next_deadline() is no later than time (on the wall clock,
+// until it has passed), e.g. for something waiting for a time outside of 
+// a task
+void request_wakeup(uint32_t time);
+
+// Set the deadline of every task to its phase from now, e.g. after the main
+// loop has been held up waiting for something, so the deadlines missed
+// meanwhile aren't counted.
+void restart_tasks(void);
+
+// Clear the stats of every task
+void clear_task_stats(void);
+
+// Return the number of tasks added and get the name, period and stats of
+// one of them (tasknum is 0 to the number of tasks - 1)
+uint8_t get_num_tasks(void);
+void get_task_stats(int8_t tasknum, TaskStats* stats);
+
+#endif /* SCHEDULER_H_ */
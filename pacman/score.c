@@ -22,6 +22,10 @@ uint32_t get_score(void) {
 	return score;
 }
 
+void set_score(uint32_t value) {
+	score = value;
+}
+
 void set_highscore (uint32_t value) {
 	high_score= value ; 
 }
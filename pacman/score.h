@@ -14,6 +14,7 @@ void init_score(void);
 
 void add_to_score(uint16_t value);
 uint32_t get_score(void);
+void set_score(uint32_t value);
 uint32_t get_highscore(void); 
 void set_highscore(uint32_t value); 
 
@@ -0,0 +1,9 @@
+/*
+ * scratch.c
+ *
+ * RAM shared between modules - see scratch.h
+ */
+
+#include "scratch.h"
+
+Scratch scratch;
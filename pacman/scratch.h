@@ -0,0 +1,28 @@
+/*
+ * scratch.h
+ *
+ * RAM shared by things which need a lot of it, but only while they are
+ * working something out - the autopilot's search, the hard ghosts' search
+ * and the game states the input log saves, checks and restores. There isn't room for each to have
+ * its own (see ram_usage.h). Nothing is kept in it from one call to the
+ * next: whoever uses it fills in what it needs and has finished with it
+ * before returning, and doesn't call anything else that uses it meanwhile.
+ */
+
+#ifndef SCRATCH_H_
+#define SCRATCH_H_
+
+#include <stdint.h>
+#include "bitboard.h"
+
+// Size in bytes - a bitboard row for each row of the field
+#define SCRATCH_SIZE (FIELD_HEIGHT * BITBOARD_ROW_WORDS * (BITBOARD_WORD_BITS / 8))
+
+typedef union {
+	BitboardRow rows[FIELD_HEIGHT];
+	uint8_t bytes[SCRATCH_SIZE];
+} Scratch;
+
+extern Scratch scratch;
+
+#endif /* SCRATCH_H_ */
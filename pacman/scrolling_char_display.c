@@ -113,27 +113,84 @@ static PixelColour colour = COLOUR_RED;
  */
 static volatile const uint8_t* next_col_ptr = 0;
 
-/* String to be displayed. 
- * next_char_to_display will be used to point to the next
- * character from this string to be displayed.
+/* Messages waiting to be displayed, oldest (the one being displayed, 
+ * if any) first. A message is kept until its last character has been
+ * started. Text in RAM is copied into the message (so the caller's 
+ * string can change straight away); text in program memory isn't.
  */
-static char* display_string;
+typedef struct {
+	const char* flash_text;		/* Text in program memory, or 0 */
+	char text[MAX_SCROLLING_TEXT_LENGTH + 1];
+	PixelColour colour;
+} Message;
+static Message messages[SCROLLING_TEXT_QUEUE_SIZE];
+static uint8_t first_message;
+static uint8_t num_messages;
 
-static volatile char* next_char_to_display = 0;
+/* next_char_to_display will be used to point to the next
+ * character from the first message to be displayed (in program
+ * memory if text_in_flash is set).
+ */
+static volatile const char* next_char_to_display = 0;
+static uint8_t text_in_flash;
+
+/* Number of columns still to scroll to get the last message off
+ * the display, and whether anything is still being displayed
+ */
+static uint8_t shift_countdown = 0;
+static uint8_t scrolling;
 
 /*
- * Set the message to be displayed - we just copy the 
- * pointer not the string it points to, so it is important
- * that the original string not change after this function
- * is called while the string is still being displayed.
- * We reset the pointers to ensure the next column to be displayed
- * comes from the first character of this string.
+ * Add a message to the end of the queue. If the text is in RAM
+ * it is copied (and cut short if it's too long).
  */
-void set_scrolling_display_text(char* string_to_display, PixelColour c) {
-	colour = c;
-	display_string = string_to_display;
+static uint8_t queue_message(const char* string, const char* flash_string, PixelColour c) {
+	Message* message;
+	uint8_t i;
+	if(num_messages == SCROLLING_TEXT_QUEUE_SIZE) {
+		return 0;
+	}
+	message = &messages[(first_message + num_messages) % SCROLLING_TEXT_QUEUE_SIZE];
+	message->flash_text = flash_string;
+	if(string) {
+		for(i = 0; i < MAX_SCROLLING_TEXT_LENGTH && string[i]; i++) {
+			message->text[i] = string[i];
+		}
+		message->text[i] = 0;
+	}
+	message->colour = c;
+	num_messages++;
+	scrolling = 1;
+	return 1;
+}
+
+uint8_t queue_scrolling_text(const char* string, PixelColour c) {
+	return queue_message(string, 0, c);
+}
+
+uint8_t queue_scrolling_text_P(const char* string, PixelColour c) {
+	return queue_message(0, string, c);
+}
+
+void clear_scrolling_text(void) {
+	num_messages = 0;
 	next_col_ptr = 0;
 	next_char_to_display = 0;
+	shift_countdown = 0;
+	scrolling = 0;
+}
+
+/*
+ * Replace whatever is being displayed or waiting to be with the 
+ * given message.
+ */
+void set_scrolling_display_text(const char* string_to_display, PixelColour c) {
+	clear_scrolling_text();
+	(void)queue_scrolling_text(string_to_display, c);
+}
+
+uint8_t is_text_scrolling(void) {
+	return scrolling;
 }
 
 /*
@@ -142,7 +199,6 @@ void set_scrolling_display_text(char* string_to_display, PixelColour c) {
  * Returns 1 if still scrolling display.
  */
 uint8_t scroll_display(void) {
-	static uint8_t shift_countdown = 0;
 	uint8_t i;
 	uint8_t col_data;
 	char next_char;
@@ -184,14 +240,21 @@ uint8_t scroll_display(void) {
 		 * (next_char_to_display) so that it points to the character 
 		 * after.
 		 */
-		next_char = *(next_char_to_display++);
+		if(text_in_flash) {
+			next_char = pgm_read_byte(next_char_to_display++);
+		} else {
+			next_char = *(next_char_to_display++);
+		}
 		if(next_char == 0) {
 			/* We reached the null character at the end of the string.
 			 * There is no next character, reset our pointer to 
-			 * the next character and set our countdown until the 
-			 * message disappears from the display.
+			 * the next character, remove the message from the queue
+			 * and set our countdown until the message disappears 
+			 * from the display.
 			 */
 			next_char_to_display = 0;
+			first_message = (first_message + 1) % SCROLLING_TEXT_QUEUE_SIZE;
+			num_messages--;
 			shift_countdown = 16;
 		} else if (next_char >= 'a' && next_char <= 'z') {
 			/* Character is a lower case letter - the next column to 
@@ -208,17 +271,20 @@ uint8_t scroll_display(void) {
 		}
 	} else {
 		/* We're not outputting a column of dots and there is 
-		 * no next character. Move on to the string that we
-		 * have stored (if any).
+		 * no next character. Move on to the next message in the
+		 * queue (if any).
 		 */
-		if(!display_string) {
+		if(num_messages == 0) {
 			/* May be finished - flag this and adjust below if we're still
 			 * showing pixels
 			 */
 			finished = 1;
+		} else {
+			Message* message = &messages[first_message];
+			text_in_flash = (message->flash_text != 0);
+			next_char_to_display = (text_in_flash ? message->flash_text : message->text);
+			colour = message->colour;
 		}
-		next_char_to_display = display_string;
-		display_string = 0;
 	}
 	
 	/* Shift the current display one pixel to the left and insert the 
@@ -243,5 +309,6 @@ uint8_t scroll_display(void) {
 		shift_countdown--;
 	}
 	finished = finished && (shift_countdown == 0);
+	scrolling = !finished;
 	return !finished;
 }
@@ -10,23 +10,44 @@
 #include <stdint.h>
 #include "pixel_colour.h"
 
+/* Messages waiting to be scrolled are kept in a queue of up to
+ * SCROLLING_TEXT_QUEUE_SIZE messages. Text in RAM is copied into
+ * the queue, so at most MAX_SCROLLING_TEXT_LENGTH characters of 
+ * it are shown. Text in program memory isn't copied, so can be 
+ * any length.
+ */
+#define SCROLLING_TEXT_QUEUE_SIZE 4
+#define MAX_SCROLLING_TEXT_LENGTH 11
+
+/* Add a message (in RAM, or in program memory for the _P version,
+ * e.g. PSTR("GAME OVER")) to the queue, to be scrolled in the 
+ * given colour after those already queued. Returns 1 if it was 
+ * added, or 0 if the queue is full.
+ */
+uint8_t queue_scrolling_text(const char* string, PixelColour colour);
+uint8_t queue_scrolling_text_P(const char* string, PixelColour colour);
+
+/* Stop scrolling and throw away all the queued messages. (What is
+ * on the display is left there.)
+ */
+void clear_scrolling_text(void);
+
 /* Sets the text to be displayed and the colour it will be
- * scrolled with. The message will start displaying immediately
- * so will overwrite/interfere with any currently scrolling
- * message. To avoid this, wait until the scroll_display()
- * function below has returned 0 to indicate the message scrolling
- * is complete. Note that this string is not 
- * copied, so it is important that this string not change
- * after this function is called while the string is still
- * being displayed.
+ * scrolled with, replacing any message being scrolled or queued.
+ * The string is copied (as for queue_scrolling_text()).
+ */
+void set_scrolling_display_text(const char* string, PixelColour colour);
+
+/* Returns 1 while a message is still scrolling (or queued), 0 when
+ * all of them have scrolled off the display.
  */
-void set_scrolling_display_text(char* string, PixelColour colour);
+uint8_t is_text_scrolling(void);
 
 /* Scroll the display. Should be called whenever the display
- * is to be scrolled one pixel to the left. It is recommended that
- * this function NOT be called from an interrupt service routine as
- * it will wait for SPI communication to be finished before returning. 
- * This could take over 1ms.
+ * is to be scrolled one pixel to the left, e.g. from a task run
+ * every so many milliseconds (the speed it scrolls at). It doesn't
+ * wait for anything - the changes are sent to the LED matrix in
+ * the background.
  * Returns 1 while a message is still scrolling, 0 when done.
  */
 uint8_t scroll_display(void);
@@ -0,0 +1,78 @@
+/*
+ * snapshot.c
+ *
+ * Saving and restoring the whole game - see snapshot.h for the format
+ */
+
+#include "snapshot.h"
+#include "score.h"
+#include "project.h"
+#include "input_log.h"
+#include "hexio.h"
+
+// Offsets of the parts of a snapshot after the game state
+#define SNAPSHOT_HIGH_SCORE (1 + GAME_STATE_SIZE)
+#define SNAPSHOT_PAUSED (SNAPSHOT_HIGH_SCORE + 4)
+#define SNAPSHOT_CHECK (SNAPSHOT_PAUSED + 1)
+
+// Sum of the bytes of a snapshot before the check byte
+static uint8_t snapshot_sum(const uint8_t* buffer) {
+	uint8_t sum = 0;
+	for(uint16_t i = 0; i < SNAPSHOT_CHECK; i++) {
+		sum += buffer[i];
+	}
+	return sum;
+}
+
+void save_snapshot(uint8_t* buffer) {
+	uint32_t high_score = get_highscore();
+	buffer[0] = SNAPSHOT_VERSION;
+	save_game_state(&buffer[1]);
+	for(uint8_t i = 0; i < 4; i++) {
+		buffer[SNAPSHOT_HIGH_SCORE + i] = high_score >> (8 * i);
+	}
+	buffer[SNAPSHOT_PAUSED] = is_paused();
+	buffer[SNAPSHOT_CHECK] = -snapshot_sum(buffer);
+}
+
+int8_t restore_snapshot(const uint8_t* buffer) {
+	uint32_t high_score = 0;
+	if(buffer[0] != SNAPSHOT_VERSION || 
+			(uint8_t)(snapshot_sum(buffer) + buffer[SNAPSHOT_CHECK]) != 0) {
+		return 0;
+	}
+	for(uint8_t i = 0; i < 4; i++) {
+		high_score |= (uint32_t)buffer[SNAPSHOT_HIGH_SCORE + i] << (8 * i);
+	}
+	if(buffer[SNAPSHOT_PAUSED] > 1 || !log_restore_game_state(&buffer[1])) {
+		return 0;
+	}
+	set_highscore(high_score);
+	set_paused(buffer[SNAPSHOT_PAUSED]);
+	return 1;
+}
+
+void send_snapshot(void) {
+	uint8_t buffer[SNAPSHOT_SIZE];
+	save_snapshot(buffer);
+	for(uint16_t i = 0; i < SNAPSHOT_SIZE; i++) {
+		output_hex_byte(buffer[i], i);
+	}
+	end_hex_output();
+}
+
+int8_t receive_snapshot(void) {
+	uint8_t buffer[SNAPSHOT_SIZE];
+	uint16_t length = 0;
+	int16_t value;
+	while((value = input_hex_byte()) >= 0) {
+		if(length < SNAPSHOT_SIZE) {
+			buffer[length] = value;
+		}
+		length++;
+	}
+	if(length != SNAPSHOT_SIZE) {
+		return 0;
+	}
+	return restore_snapshot(buffer);
+}
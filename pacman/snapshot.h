@@ -0,0 +1,45 @@
+/*
+ * snapshot.h
+ *
+ * Snapshots of everything needed to carry on with a game from where it
+ * was: the game state (see save_game_state()), the high score and whether
+ * the game is paused. A snapshot is SNAPSHOT_SIZE bytes:
+ *	- SNAPSHOT_VERSION (a snapshot with a different version is rejected)
+ *	- GAME_STATE_SIZE bytes of game state
+ *	- the high score (4 bytes, LSB first)
+ *	- 1 if paused, 0 otherwise
+ *	- a check byte chosen so that all the bytes add up to 0 (mod 256)
+ * Snapshots can be sent and received over the serial port (in hex - see
+ * hexio.h), so a game can be saved and later carried on from the same 
+ * point, or a test can start from any state it likes.
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <stdint.h>
+#include "levels.h"
+#include "game.h"
+
+// Change this whenever the snapshot (or game state) format changes
+#define SNAPSHOT_VERSION 2
+
+#define SNAPSHOT_SIZE (GAME_STATE_SIZE + 7)
+
+// Save a snapshot of the game into buffer (SNAPSHOT_SIZE bytes)
+void save_snapshot(uint8_t* buffer);
+
+// Restore the game from a snapshot, redrawing the display. Returns 1 if
+// successful, 0 (with nothing changed) if the snapshot has the wrong 
+// version or check byte or a game state is_valid_game_state() rejects. The restore is recorded in the input log.
+int8_t restore_snapshot(const uint8_t* buffer);
+
+// Save a snapshot and output it over the serial port
+void send_snapshot(void);
+
+// Read a snapshot from the serial port and restore the game from it. 
+// Returns 1 if successful, 0 if the snapshot was the wrong size or was
+// rejected by restore_snapshot().
+int8_t receive_snapshot(void);
+
+#endif /* SNAPSHOT_H_ */
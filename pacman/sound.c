@@ -0,0 +1,200 @@
+/*
+ * sound.c
+ *
+ * Sound effects played by timer 2 - see sound.h
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "sound.h"
+#include "timer1.h"
+
+// Timer 2 counts at 8MHz / 128, so a note of frequency f Hz has a cycle
+// of SOUND_TIMER_HZ / f counts. The longest cycle is 256 counts, so the
+// lowest note is about 245 Hz.
+#define SOUND_TIMER_HZ 62500UL
+
+// Each note is 3 bytes: the timer's TOP value (one less than the number
+// of counts in a cycle, or 0 for a rest) and the number of cycles (low 
+// byte first). A sound ends with 0 cycles. Notes are given as a frequency
+// (Hz) and a length (ms).
+#define NOTE_SIZE 3
+#define NOTE_TOP(hz) (SOUND_TIMER_HZ / (hz) - 1)
+#define NOTE_CYCLES(top, ms) ((uint16_t)((ms) * SOUND_TIMER_HZ / 1000 / ((top) + 1)))
+#define NOTE(hz, ms) NOTE_TOP(hz), NOTE_CYCLES(NOTE_TOP(hz), ms) & 0xFF, NOTE_CYCLES(NOTE_TOP(hz), ms) >> 8
+#define REST(ms) 0, NOTE_CYCLES(255, ms) & 0xFF, NOTE_CYCLES(255, ms) >> 8
+#define END_OF_SOUND 0, 0, 0
+
+static const uint8_t pacdot_sound[] PROGMEM = {
+	NOTE(400, 15), NOTE(600, 15), NOTE(800, 15), END_OF_SOUND
+};
+static const uint8_t pellet_sound[] PROGMEM = {
+	NOTE(400, 30), NOTE(600, 30), NOTE(800, 30), NOTE(1000, 30), END_OF_SOUND
+};
+static const uint8_t ghost_eaten_sound[] PROGMEM = {
+	NOTE(300, 20), NOTE(500, 20), NOTE(800, 20), NOTE(1100, 20), 
+	NOTE(1500, 20), NOTE(1800, 40), END_OF_SOUND
+};
+static const uint8_t death_sound[] PROGMEM = {
+	NOTE(1000, 80), NOTE(900, 80), NOTE(800, 80), NOTE(700, 80),
+	NOTE(600, 80), NOTE(500, 80), NOTE(400, 80), NOTE(300, 150),
+	REST(50), NOTE(300, 60), REST(40), NOTE(300, 60), END_OF_SOUND
+};
+
+// Sounds in the order of their numbers (see sound.h)
+static const uint8_t* const sounds[] PROGMEM = {
+	pacdot_sound, pellet_sound, ghost_eaten_sound, death_sound
+};
+
+// One cycle notes, for measure_sound_cost()
+static const uint8_t cost_notes[] PROGMEM = {
+	100, 1, 0, 100, 1, 0, 100, 1, 0, 100, 1, 0, 100, 1, 0, 100, 1, 0,
+	100, 1, 0, 100, 1, 0, 100, 1, 0, 100, 1, 0, 100, 1, 0, 100, 1, 0,
+	100, 1, 0, 100, 1, 0, 100, 1, 0, 100, 1, 0, END_OF_SOUND
+};
+
+// The next note to be played, the number of cycles of the note now 
+// playing still to go, and the sound playing (if playing is set)
+static const uint8_t* volatile next_note;
+static volatile uint16_t cycles_left;
+static volatile uint8_t playing;
+static uint8_t sound_playing;
+
+static uint8_t muted;
+
+void init_sound(void) {
+	// The buzzer pin is an output, low when no note is playing
+	DDRD |= (1<<6);
+	PORTD &= ~(1<<6);
+	stop_sound();
+}
+
+// Stop timer 2 and its interrupt, and disconnect the buzzer pin. (Called
+// with interrupts off, or from the interrupt handler.)
+static void stop_timer2(void) {
+	TCCR2B = 0;
+	TCCR2A = 0;
+	TIMSK2 &= ~(1<<TOIE2);
+	playing = 0;
+}
+
+// Start the next note (or stop at the end of the sound). The new TOP and
+// compare values take effect at the end of the current cycle, so there 
+// are no glitches. (Called with interrupts off, or from the interrupt 
+// handler.)
+static void start_next_note(void) {
+	uint8_t top = pgm_read_byte(next_note);
+	uint16_t cycles = pgm_read_word(next_note + 1);
+	if(cycles == 0) {
+		stop_timer2();
+		return;
+	}
+	next_note += NOTE_SIZE;
+	cycles_left = cycles;
+	if(top == 0) {
+		// A rest - the timer keeps counting but the pin stays low
+		OCR2A = 255;
+		TCCR2A = (1<<WGM21)|(1<<WGM20);
+	} else {
+		// Fast PWM with TOP = OCR2A, OC2B high for the first half of 
+		// each cycle
+		OCR2A = top;
+		OCR2B = top / 2;
+		TCCR2A = (1<<COM2B1)|(1<<WGM21)|(1<<WGM20);
+	}
+}
+
+void play_sound(uint8_t sound) {
+	uint8_t interrupts_on;
+	if(muted) {
+		return;
+	}
+	interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	if(!playing || sound > sound_playing) {
+		sound_playing = sound;
+		next_note = (const uint8_t*)pgm_read_word(&sounds[sound]);
+		start_next_note();
+		if(!playing) {
+			// Start timer 2 (divide the clock by 128) from the start of
+			// a cycle, interrupting at the end of each cycle
+			playing = 1;
+			TCNT2 = 0;
+			TIFR2 = (1<<TOV2);
+			TIMSK2 |= (1<<TOIE2);
+			TCCR2B = (1<<WGM22)|(1<<CS22)|(1<<CS20);
+		}
+	}
+	if(interrupts_on) {
+		sei();
+	}
+}
+
+void play_game_event_sound(const GameEvent* event) {
+	switch(event->type) {
+		case GAME_EVENT_PACDOT_EATEN:
+			play_sound(SOUND_PACDOT);
+			break;
+		case GAME_EVENT_PELLET_EATEN:
+			play_sound(SOUND_PELLET);
+			break;
+		case GAME_EVENT_GHOST_EATEN:
+			play_sound(SOUND_GHOST_EATEN);
+			break;
+		case GAME_EVENT_LIFE_LOST:
+			play_sound(SOUND_DEATH);
+			break;
+	}
+}
+
+void stop_sound(void) {
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	stop_timer2();
+	if(interrupts_on) {
+		sei();
+	}
+}
+
+void set_sound_muted(uint8_t mute) {
+	muted = mute;
+	if(muted) {
+		stop_sound();
+	}
+}
+
+uint8_t is_sound_muted(void) {
+	return muted;
+}
+
+// End of a cycle of the note - count it, and start the next note when 
+// this one is finished
+ISR(TIMER2_OVF_vect) {
+	if(--cycles_left == 0) {
+		start_next_note();
+	}
+}
+
+void measure_sound_cost(uint16_t* count_time, uint16_t* note_time) {
+	uint16_t start_time;
+	stop_sound();
+	// The interrupt handler is called directly (it returns with interrupts
+	// on, as they are now anyway). Timer 2 is stopped so the pin doesn't
+	// change.
+	cycles_left = 0xFFFF;
+	start_time = get_timer1_count();
+	for(uint8_t i = 0; i < SOUND_COST_CALLS; i++) {
+		TIMER2_OVF_vect();
+	}
+	*count_time = get_timer1_count() - start_time;
+	next_note = cost_notes;
+	cycles_left = 1;
+	start_time = get_timer1_count();
+	for(uint8_t i = 0; i < SOUND_COST_CALLS; i++) {
+		TIMER2_OVF_vect();
+	}
+	*note_time = get_timer1_count() - start_time;
+	stop_sound();
+}
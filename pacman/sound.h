@@ -0,0 +1,54 @@
+/*
+ * sound.h
+ *
+ * Sound effects on a piezo buzzer connected to OC2B (pin D6), played in
+ * the background. Timer 2 makes the tone itself (fast PWM, a square wave
+ * at the note's frequency), and its overflow interrupt (at the end of
+ * each cycle of the tone) counts down how long the note has left and 
+ * starts the next one. Each sound is a list of notes kept in program 
+ * memory, so starting one only takes a few instructions and nothing
+ * waits for it to finish. Timer 2 is stopped when nothing is playing.
+ *
+ * The interrupt handler is kept short as it runs once per cycle of the
+ * tone (up to a few thousand times a second) - measure_sound_cost() 
+ * measures it. (It doesn't use timer 1 - see timer1.h.)
+ */
+
+#ifndef SOUND_H_
+#define SOUND_H_
+
+#include <stdint.h>
+#include "game.h"
+
+// Sounds, lowest priority first. A sound doesn't interrupt one of a 
+// higher priority (or the same sound) which is still playing.
+#define SOUND_PACDOT 0
+#define SOUND_PELLET 1
+#define SOUND_GHOST_EATEN 2
+#define SOUND_DEATH 3
+
+// Set up timer 2 and the buzzer pin (silent)
+void init_sound(void);
+
+// Start playing a sound (unless muted, or a more important sound is 
+// playing). Returns straight away.
+void play_sound(uint8_t sound);
+
+// Play the sound (if any) for a game event (taken from get_game_event())
+void play_game_event_sound(const GameEvent* event);
+
+// Stop any sound playing now
+void stop_sound(void);
+
+// Turn sound off (muted = 1) or on, and find out which it is
+void set_sound_muted(uint8_t muted);
+uint8_t is_sound_muted(void);
+
+// Time (in timer 1 counts, i.e. microseconds) SOUND_COST_CALLS calls of
+// the timer 2 interrupt handler take (including saving and restoring 
+// registers) when it only counts down the note, and when it starts a new 
+// note every time. Any sound playing is stopped.
+#define SOUND_COST_CALLS 16
+void measure_sound_cost(uint16_t* count_time, uint16_t* note_time);
+
+#endif /* SOUND_H_ */
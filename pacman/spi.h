@@ -12,7 +12,8 @@
 void spi_setup_master(uint8_t clockdivider);
 
 // Send and receive an SPI byte. This function will take at least 8 
-// cyles of the divided clock (i.e. will busy wait).
+// cyles of the divided clock (i.e. will busy wait). (Don't use this if the
+// SPI interrupt is enabled - e.g. by ledmatrix_setup().)
 uint8_t spi_send_byte(uint8_t byte);
 
 #endif /* SPI_H_ */
\ No newline at end of file
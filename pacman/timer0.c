@@ -6,18 +6,137 @@
  * We setup timer0 to generate an interrupt every 1ms
  * We update a global clock tick variable - whose value
  * can be retrieved using the get_clock_ticks() function.
+ *
+ * In tickless mode (the default - see timer0.h) timer 0 instead
+ * runs freely and the clock is worked out from how far it has
+ * counted. The interrupt only comes when someone needs to be
+ * woken up, or often enough that we don't lose count.
  */
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
 #include "timer0.h"
-#include "project.h"
 
 /* Our internal clock tick count - incremented every 
  * millisecond. Will overflow every ~49 days. */
 static volatile uint32_t clockTicks;
 
+/* The wall clock - the same, but never paused */
+static volatile uint32_t wallClockTicks;
+
+/* Set if the (game) clock is stopped (the game is paused) */
+static volatile uint8_t clockPaused;
+
+/* Number of timer 0 interrupts so far */
+static volatile uint32_t interruptCount;
+
+#if TIMER0_TICKLESS
+
+/* Timer 0 counts once every 1024 clock cycles, i.e. every 128us
+ * or 16/125 of a millisecond. The part of a millisecond that has
+ * been counted but not yet added to clockTicks is kept in
+ * 1/125ths of a millisecond.
+ */
+#define MS_PER_COUNT_NUMERATOR 16
+#define MS_PER_COUNT_DENOMINATOR 125
+static volatile uint16_t clockFraction;
+
+/* The timer count when the clock was last brought up to date */
+static volatile uint8_t lastCount;
+
+/* Most counts (about 26ms) we let go by without an interrupt.
+ * This must be less than 256 so that we can tell how far the
+ * counter has gone.
+ */
+#define MAX_COUNTS_BETWEEN_INTERRUPTS 200
+
+/* Add the time since we last looked at the counter to the wall
+ * clock and to the clock (unless it is paused). Must be called 
+ * with interrupts off.
+ */
+static void update_clock(void) {
+	uint8_t count = TCNT0;
+	uint8_t elapsed = count - lastCount;
+	lastCount = count;
+	clockFraction += elapsed * MS_PER_COUNT_NUMERATOR;
+	/* Usually no more than a count or two has gone by so this
+	 * is quicker than dividing.
+	 */
+	while(clockFraction >= MS_PER_COUNT_DENOMINATOR) {
+		clockFraction -= MS_PER_COUNT_DENOMINATOR;
+		wallClockTicks++;
+		if(!clockPaused) {
+			clockTicks++;
+		}
+	}
+}
+
+/* Set up timer 0 to count every 1024 clock cycles (128us) and
+ * give us an interrupt when it next needs looking at.
+ */
+void init_timer0(void) {
+	clockTicks = 0L;
+	wallClockTicks = 0L;
+	clockFraction = 0;
+
+	/* Clear the timer */
+	TCNT0 = 0;
+	lastCount = 0;
+
+	/* Normal mode (count up to 255 and start again from 0) and
+	 * divide the clock by 1024. This starts the timer running.
+	 */
+	TCCR0A = 0;
+	TCCR0B = (1<<CS02)|(1<<CS00);
+
+	/* Interrupt on output compare match - first when it's time
+	 * to bring the clock up to date.
+	 */
+	OCR0A = MAX_COUNTS_BETWEEN_INTERRUPTS;
+	TIMSK0 |= (1<<OCIE0A);
+	TIFR0 = (1<<OCF0A);
+}
+
+void set_timer0_wakeup(uint32_t time) {
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	uint16_t counts = MAX_COUNTS_BETWEEN_INTERRUPTS;
+	uint32_t timeToGo;
+	uint8_t target, ahead;
+	cli();
+	update_clock();
+	timeToGo = time - wallClockTicks;
+	if((int32_t)timeToGo > 0 && timeToGo < 256) {
+		/* Time to go in 1/125ths of a millisecond, then in counts
+		 * (rounded up so we don't wake up too early). Anything
+		 * further off than the longest we can wait anyway is left
+		 * out, so this fits in 16 bits.
+		 */
+		counts = (uint16_t)timeToGo * MS_PER_COUNT_DENOMINATOR - clockFraction;
+		counts = (counts + MS_PER_COUNT_NUMERATOR - 1) / MS_PER_COUNT_NUMERATOR;
+		if(counts > MAX_COUNTS_BETWEEN_INTERRUPTS) {
+			counts = MAX_COUNTS_BETWEEN_INTERRUPTS;
+		}
+	}
+	/* A compare match only happens when the counter moves on to
+	 * the compare value, so if it has already got there (or is
+	 * about to while we set it) we'd miss it and not be woken up
+	 * until the counter comes all the way round. Ask for a count
+	 * or two from now instead.
+	 */
+	target = lastCount + counts;
+	ahead = target - TCNT0;
+	if(ahead < 2 || ahead > counts) {
+		target = TCNT0 + 2;
+	}
+	OCR0A = target;
+	if(interruptsOn) {
+		sei();
+	}
+}
+
+#else
+
 /* Set up timer 0 to generate an interrupt every 1ms. 
  * We will divide the clock by 64 and count up to 124.
  * We will therefore get an interrupt every 64 x 125
@@ -31,10 +150,11 @@ void init_timer0(void) {
 	 * constant. 
 	 */
 	clockTicks = 0L;
+	wallClockTicks = 0L;
 	
 	/* Clear the timer */
 	TCNT0 = 0;
-
+	
 	/* Set the output compare value to be 124 */
 	OCR0A = 124;
 	
@@ -44,7 +164,7 @@ void init_timer0(void) {
 	 */
 	TCCR0A = (1<<WGM01);
 	TCCR0B = (1<<CS01)|(1<<CS00);
-
+	
 	/* Enable an interrupt on output compare match. 
 	 * Note that interrupts have to be enabled globally
 	 * before the interrupts will fire.
@@ -57,6 +177,12 @@ void init_timer0(void) {
 	TIFR0 &= (1<<OCF0A);
 }
 
+void set_timer0_wakeup(uint32_t time) {
+	/* Nothing to do - we're woken up every millisecond anyway */
+}
+
+#endif /* TIMER0_TICKLESS */
+
 uint32_t get_current_time(void) {
 	uint32_t returnValue;
 
@@ -67,6 +193,9 @@ uint32_t get_current_time(void) {
 	 */
 	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
 	cli();
+#if TIMER0_TICKLESS
+	update_clock();
+#endif
 	returnValue = clockTicks;
 	if(interruptsOn) {
 		sei();
@@ -74,9 +203,63 @@ uint32_t get_current_time(void) {
 	return returnValue;
 }
 
+uint32_t get_wall_time(void) {
+	uint32_t returnValue;
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+#if TIMER0_TICKLESS
+	update_clock();
+#endif
+	returnValue = wallClockTicks;
+	if(interruptsOn) {
+		sei();
+	}
+	return returnValue;
+}
+
+void set_clock_paused(uint8_t paused) {
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+#if TIMER0_TICKLESS
+	/* Count the time up to now at the old setting */
+	update_clock();
+#endif
+	clockPaused = paused;
+	if(interruptsOn) {
+		sei();
+	}
+}
+
+uint8_t is_clock_paused(void) {
+	return clockPaused;
+}
+
+uint32_t get_timer0_interrupts(void) {
+	uint32_t returnValue;
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+	returnValue = interruptCount;
+	if(interruptsOn) {
+		sei();
+	}
+	return returnValue;
+}
+
 ISR(TIMER0_COMPA_vect) {
-	/* Increment our clock tick count if pause status is 0 (i.e. Resumed) */
-	if (is_paused() == 0){
+	interruptCount++;
+#if TIMER0_TICKLESS
+	/* Bring the clock up to date and come back before the counter
+	 * gets right round again. (If this interrupt was to wake
+	 * someone up, they'll ask for the next one before sleeping.)
+	 */
+	update_clock();
+	OCR0A = lastCount + MAX_COUNTS_BETWEEN_INTERRUPTS;
+#else
+	/* Increment our clock tick counts (the game clock only if 
+	 * it isn't paused) */
+	wallClockTicks++;
+	if (!clockPaused){
 		clockTicks++;
 	}
+#endif
 }
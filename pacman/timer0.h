@@ -20,14 +20,60 @@
 
 #include <stdint.h>
 
+/* In tickless mode the interrupt doesn't come every millisecond.
+ * The timer counts freely (every 128us) and the clock is worked
+ * out from its count whenever it is read. The interrupt only 
+ * comes when set_timer0_wakeup() asks for it, or often enough
+ * (every 26ms or so) that the count isn't lost, so sleeping 
+ * while waiting for something doesn't mean being woken up 
+ * every millisecond. Set TIMER0_TICKLESS to 0 at compile time 
+ * for an interrupt every millisecond instead.
+ */
+#ifndef TIMER0_TICKLESS
+#define TIMER0_TICKLESS 1
+#endif
+
 /* Set up our timer to give us an interrupt every millisecond
- * and update our time reference.
+ * (or when needed in tickless mode) and update our time reference.
  */
 void init_timer0(void);
 
-/* Return the current clock tick value - milliseconds since the timer was
- * initialised.
+/* There are two clocks. Use the game clock for anything which 
+ * should stop while the game is paused (e.g. the game itself and
+ * the tasks which run it) and the wall clock for anything else
+ * (e.g. key repeats or measuring how long things take). For times
+ * to the microsecond see get_timestamp() in timer1.h.
+ */
+
+/* Return the current (game) clock tick value - milliseconds since 
+ * the timer was initialised, not counting while it is paused.
  */
 uint32_t get_current_time(void);
 
+/* Return the wall clock - milliseconds since the timer was 
+ * initialised. This never stops.
+ */
+uint32_t get_wall_time(void);
+
+/* Stop (paused = 1) or restart (paused = 0) the game clock, e.g. 
+ * while the game is paused.
+ */
+void set_clock_paused(uint8_t paused);
+
+/* Return 1 if the game clock is stopped, 0 if it is running
+ */
+uint8_t is_clock_paused(void);
+
+/* Make sure the next timer interrupt comes by the given wall clock
+ * time so that sleeping until the next interrupt wakes us up in time.
+ * This only lasts until the next interrupt, so should be called
+ * just before going to sleep. (Does nothing if not in tickless 
+ * mode, as there is an interrupt every millisecond.)
+ */
+void set_timer0_wakeup(uint32_t time);
+
+/* Return the number of timer 0 interrupts so far
+ */
+uint32_t get_timer0_interrupts(void);
+
 #endif
\ No newline at end of file
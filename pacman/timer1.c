@@ -0,0 +1,82 @@
+/*
+ * timer1.c
+ *
+ * We setup timer1 as a free running counter incremented every
+ * 8 clock cycles (1 microsecond with an 8MHz clock). See timer1.h.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "timer1.h"
+
+/* Number of times the counter has wrapped around - the top 16 bits
+ * of the timestamp. */
+static volatile uint16_t overflowCount;
+
+void init_timer1(void) {
+	/* Clear the timer */
+	TCNT1 = 0;
+	
+	/* Normal mode (count up to 0xFFFF and wrap around), no
+	 * output compare pins used. Divide the clock by 8. This
+	 * starts the timer running.
+	 */
+	TCCR1A = 0;
+	TCCR1B = (1<<CS11);
+	
+	/* Interrupt when the counter wraps around (every 65.536ms)
+	 * so we can count the wraps for get_timestamp(). 
+	 */
+	overflowCount = 0;
+	TIFR1 = (1<<TOV1);
+	TIMSK1 |= (1<<TOIE1);
+}
+
+uint16_t get_timer1_count(void) {
+	uint16_t returnValue;
+	
+	/* Reading a 16 bit timer register uses a shared temporary
+	 * register for the high byte so we make sure no interrupt
+	 * can fire between the two byte reads.
+	 */
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+	returnValue = TCNT1;
+	if(interruptsOn) {
+		sei();
+	}
+	return returnValue;
+}
+
+uint32_t get_timestamp(void) {
+	uint16_t high, highAgain, low;
+	
+	/* Rather than turn interrupts off we read the wrap count 
+	 * either side of the counter and try again if it changed (the
+	 * interrupt came in between, or while we were part way through
+	 * reading the count). The two bytes of TCNT1 are read together
+	 * by the hardware (the high byte is latched when the low byte
+	 * is read) - the only thing that can upset this is an interrupt
+	 * handler reading a 16 bit timer register in between, and none
+	 * do.
+	 */
+	do {
+		high = overflowCount;
+		low = TCNT1;
+		/* If the counter has wrapped but the interrupt hasn't been 
+		 * handled yet (e.g. interrupts are off, or it has only just
+		 * happened) count the wrap ourselves. A small count means 
+		 * we read it after the wrap. 
+		 */
+		if((TIFR1 & (1<<TOV1)) && low < 0x8000) {
+			high++;
+		}
+		highAgain = overflowCount;
+	} while(high != highAgain && high != highAgain + 1);
+	return ((uint32_t)high << 16) | low;
+}
+
+ISR(TIMER1_OVF_vect) {
+	overflowCount++;
+}
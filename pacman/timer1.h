@@ -0,0 +1,42 @@
+/*
+ * timer1.h
+ *
+ * We set up timer 1 as a free running 16 bit counter that
+ * counts once every 8 clock cycles (i.e. once per microsecond
+ * with an 8MHz clock). It is used to measure how long short
+ * pieces of code take to run - e.g. to keep background work 
+ * within a budget. The counter wraps every 65.536ms so it can
+ * only be used to measure intervals shorter than this. Use 
+ * unsigned 16 bit subtraction to get the elapsed count, e.g. 
+ *		uint16_t start = get_timer1_count();
+ *		...
+ *		uint16_t elapsed = get_timer1_count() - start;
+ * The only interrupt used is on the counter wrapping around,
+ * which is counted to make longer timestamps (get_timestamp()).
+ */
+
+#ifndef TIMER1_H_
+#define TIMER1_H_
+
+#include <stdint.h>
+
+/* Number of CPU clock cycles per timer 1 count */
+#define TIMER1_CYCLES_PER_COUNT 8
+
+/* Set up timer 1 as a free running counter (clock divided by 8).
+ */
+void init_timer1(void);
+
+/* Return the current timer 1 count. 
+ */
+uint16_t get_timer1_count(void);
+
+/* Return a timestamp in microseconds - the timer 1 count with the 
+ * number of times it has wrapped around on top. (Wraps around itself
+ * every 71 minutes, so use unsigned 32 bit subtraction.) This doesn't 
+ * turn interrupts off so it can be used anywhere, e.g. to time 
+ * interrupts.
+ */
+uint32_t get_timestamp(void);
+
+#endif
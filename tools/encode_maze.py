@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Encode a maze picture into the compressed form used in pacman/levels.c.
+
+Usage: encode_maze.py NAME < maze.txt
+
+maze.txt holds one line per row of the field (FIELD_HEIGHT lines of
+FIELD_WIDTH characters - 31x31 unless the field size has been changed in
+pacman/game.h) using the characters described at the top of
+pacman/levels.c. The output is a pair of C array definitions (with the
+maze picture as a comment) ready to paste into levels.c:
+    NAME_field - the encoded maze (see pacman/maze.h for the encoding)
+    NAME_cells - the walkable cell index of the first walkable cell in
+                 each row, followed by the total number of walkable cells
+Spaces that can't be reached from any pac-dot or power pellet are encoded
+as filled (shown as spaces but treated as walls).
+"""
+import sys
+
+# Cell classes in the order of the CELL_CLASS_ values in maze.h, with the
+# macro name used for each in levels.c
+CLASSES = [(' ', 'SP'), ('.', 'DOT'), ('P', 'PEL'), ('-', 'HZ'), ('|', 'VT'),
+           ('F', 'DR'), ('7', 'DL'), ('L', 'UR'), ('J', 'UL'), ('>', 'VR'),
+           ('<', 'VL'), ('^', 'HU'), ('v', 'HD'), ('+', 'VH'), ('#', 'FIL')]
+MIRROR = {'F': '7', '7': 'F', 'L': 'J', 'J': 'L', '>': '<', '<': '>'}
+MAX_RUN = 16
+
+
+def runs(row):
+    out = []
+    i = 0
+    while i < len(row):
+        j = i
+        while j < len(row) and row[j] == row[i] and j - i < MAX_RUN:
+            j += 1
+        out.append((row[i], j - i))
+        i = j
+    return out
+
+
+def fill_unreachable(rows):
+    """Replace spaces that can't be reached from a pac-dot or pellet with #"""
+    height, width = len(rows), len(rows[0])
+    reached = set()
+    todo = [(x, y) for y in range(height) for x in range(width)
+            if rows[y][x] in '.P']
+    while todo:
+        x, y = todo.pop()
+        if (x, y) in reached:
+            continue
+        reached.add((x, y))
+        for nx, ny in ((x - 1, y), (x + 1, y), (x, y - 1), (x, y + 1)):
+            nx %= width     # tunnels wrap around
+            if 0 <= ny < height and rows[ny][nx] in ' .P':
+                todo.append((nx, ny))
+    return [''.join('#' if c == ' ' and (x, y) not in reached else c
+                    for x, c in enumerate(r)) for y, r in enumerate(rows)]
+
+
+def main():
+    name = sys.argv[1]
+    picture = [line.rstrip('\n') for line in sys.stdin]
+    while picture and not picture[-1]:
+        picture.pop()
+    width = len(picture[0])
+    assert all(len(r) == width for r in picture), 'rows must all be the same width'
+    rows = fill_unreachable(picture)
+    half = width // 2 + 1
+    mirrored = all(r[width - 1 - x] == MIRROR.get(r[x], r[x])
+                   for r in rows for x in range(half))
+    names = dict(CLASSES)
+    size = 1
+    print('// %s' % ('(mirrored)' if mirrored else ''))
+    for r in picture:
+        print('//   %s' % r)
+    print('static const uint8_t %s_field[] PROGMEM = {' % name)
+    print('\t%s,' % ('MAZE_MIRRORED' if mirrored else '0'))
+    for r in rows:
+        encoded = runs(r[:half] if mirrored else r)
+        size += len(encoded)
+        print('\t' + ' '.join('R(%s,%d),' % (names[c], n) for c, n in encoded))
+    print('};')
+    print('// %d bytes' % size)
+    cells = [0]
+    for r in rows:
+        cells.append(cells[-1] + sum(1 for c in r if c in ' .P'))
+    print('static const uint16_t %s_cells[FIELD_HEIGHT + 1] PROGMEM = {' % name)
+    for i in range(0, len(cells), 8):
+        print('\t' + ' '.join('%d,' % c for c in cells[i:i + 8]))
+    print('};')
+    print('// %d walkable cells' % cells[-1])
+
+
+if __name__ == '__main__':
+    main()
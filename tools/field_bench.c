@@ -0,0 +1,114 @@
+/*
+ * field_bench.c
+ *
+ * Host benchmark of the game field bitboards (pacman/bitboard.h) at 
+ * different field sizes. Build once per size with -DFIELD_WIDTH=... and
+ * -DFIELD_HEIGHT=... (tools/field_bench.sh does this for a range of sizes).
+ *
+ * A maze-like field is made up (a grid of 2x2 blocks with corridors in
+ * between, pac-dots in every corridor) and then we time:
+ *	- query: is there a wall/pac-dot at a random location?
+ *	- move:  an actor moves to a random neighbouring open cell (checking
+ *	         the walls in all four directions) and eats any pac-dot there
+ *	- scan:  count all the pac-dots on the field (as done when a level is
+ *	         set up), per cell
+ * Times are nanoseconds per operation on the host - the relative cost 
+ * at each size is what matters.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "bitboard.h"
+
+#define QUERIES 20000000UL
+#define MOVES 20000000UL
+#define SCANS 20000UL
+
+static BitboardRow walls[FIELD_HEIGHT];
+static BitboardRow pacdots[FIELD_HEIGHT];
+
+// Deterministic pseudo-random numbers so every size does the same work
+static uint32_t rng_state = 1;
+static uint32_t next_random(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void make_field(void) {
+	for(uint8_t y = 0; y < FIELD_HEIGHT; y++) {
+		bitboard_clear_row(walls[y]);
+		bitboard_clear_row(pacdots[y]);
+		for(uint8_t x = 0; x < FIELD_WIDTH; x++) {
+			if(x == 0 || y == 0 || x == FIELD_WIDTH - 1 || y == FIELD_HEIGHT - 1
+					|| (x % 3 != 1 && y % 3 != 1)) {
+				bitboard_set(walls[y], x);
+			} else {
+				bitboard_set(pacdots[y], x);
+			}
+		}
+	}
+}
+
+int main(void) {
+	volatile uint32_t sink = 0;
+	double start;
+	make_field();
+
+	start = now_ns();
+	for(uint32_t i = 0; i < QUERIES; i++) {
+		uint32_t r = next_random();
+		uint8_t x = (r & 0xFFFF) % FIELD_WIDTH;
+		uint8_t y = (r >> 16) % FIELD_HEIGHT;
+		sink += bitboard_test(walls[y], x) + bitboard_test(pacdots[y], x);
+	}
+	double query_ns = (now_ns() - start) / QUERIES;
+
+	static const int8_t dx[4] = { -1, 0, 1, 0 };
+	static const int8_t dy[4] = { 0, -1, 0, 1 };
+	uint8_t x = 1, y = 1;
+	start = now_ns();
+	for(uint32_t i = 0; i < MOVES; i++) {
+		uint8_t options = 0;
+		for(uint8_t d = 0; d < 4; d++) {
+			if(!bitboard_test(walls[y + dy[d]], x + dx[d])) {
+				options |= (1 << d);
+			}
+		}
+		uint8_t d = next_random() % 4;
+		while(!(options & (1 << d))) {
+			d = (d + 1) % 4;
+		}
+		x += dx[d];
+		y += dy[d];
+		if(bitboard_test(pacdots[y], x)) {
+			bitboard_clear(pacdots[y], x);
+			sink++;
+		}
+	}
+	double move_ns = (now_ns() - start) / MOVES;
+
+	start = now_ns();
+	for(uint32_t i = 0; i < SCANS; i++) {
+		for(uint8_t y = 0; y < FIELD_HEIGHT; y++) {
+			for(uint8_t x = 0; x < FIELD_WIDTH; x++) {
+				sink += bitboard_test(pacdots[y], x);
+			}
+		}
+	}
+	double scan_ns = (now_ns() - start) / SCANS / (FIELD_WIDTH * FIELD_HEIGHT);
+
+	printf("%3dx%-3d %d word(s)/row %6u bytes/bitboard  query %5.2f ns  move %5.2f ns  scan %5.2f ns/cell\n",
+			FIELD_WIDTH, FIELD_HEIGHT, BITBOARD_ROW_WORDS, (unsigned)sizeof(walls),
+			query_ns, move_ns, scan_ns);
+	return (int)(sink & 0);
+}
@@ -0,0 +1,12 @@
+#!/bin/sh
+# Build and run tools/field_bench.c for a range of field sizes.
+# Usage: tools/field_bench.sh [cc]
+CC=${1:-cc}
+DIR=$(dirname "$0")
+OUT=${TMPDIR:-/tmp}/field_bench.$$
+for size in 31 32 33 63 64 95 127 191 255; do
+	$CC -std=gnu99 -O2 -I"$DIR/../pacman" -DFIELD_WIDTH=$size -DFIELD_HEIGHT=$size \
+		-o "$OUT" "$DIR/field_bench.c" || exit 1
+	"$OUT"
+done
+rm -f "$OUT"
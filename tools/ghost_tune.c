@@ -0,0 +1,85 @@
+/*
+ * ghost_tune.c
+ *
+ * Host tool for tuning the hard ghosts (pacman/ghost_search.c). The
+ * autopilot (pacman/autopilot.c) plays the same set of games against 
+ * normal and then hard ghosts, with nothing drawn, and we output how well
+ * it did against each and how long the hard ghosts' searches took. Build
+ * and run with tools/ghost_tune.sh, which can set the search depth.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "game.h"
+#include "score.h"
+#include "autopilot.h"
+#include "ghost_search.h"
+#include "timer0.h"
+#include "timer1.h"
+
+#ifndef GAMES
+#define GAMES 20
+#endif
+
+// Longest a game is played for (ms of game time) - in case the autopilot
+// manages to stay out of the ghosts' way for good
+#define MAX_GAME_TICKS 1200000UL
+
+// Clock functions the game needs. The game time only moves on when we call
+// advance_game_time() so the clock can stay at 0. Timer 1 counts real 
+// microseconds so the search times are for this computer.
+uint32_t get_current_time(void) {
+	return 0;
+}
+
+uint16_t get_timer1_count(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
+
+static void play_games(uint8_t difficulty) {
+	uint32_t levels = 0, lives_lost = 0;
+	uint64_t ticks = 0, score = 0;
+	for(uint16_t game = 0; game < GAMES; game++) {
+		set_random_state(game + 1);
+		set_ghost_difficulty(difficulty);
+		reset_lives();
+		init_score();
+		initialise_game();
+		uint8_t lives = get_lives();
+		for(uint32_t tick = 0; tick < MAX_GAME_TICKS && get_lives() > 0; tick++) {
+			int8_t direction = autopilot_direction();
+			if(direction >= 0) {
+				change_pacman_direction(direction);
+			}
+			advance_game_time();
+			ticks++;
+			if(get_lives() != lives) {
+				lives = get_lives();
+				lives_lost++;
+			}
+			if(is_level_complete()) {
+				initialise_next_level();
+				levels++;
+			}
+		}
+		score += get_score();
+	}
+	printf("%-6s ghosts: %u games, average score %lu, %.2f levels per game, %.2f lives lost per minute\n",
+			difficulty == GHOSTS_HARD ? "hard" : "normal", GAMES, 
+			(unsigned long)(score / GAMES), (double)levels / GAMES, lives_lost * 60000.0 / ticks);
+}
+
+int main(void) {
+	uint16_t searches, max_time, max_steps, cut_short, hits, misses;
+	play_games(GHOSTS_NORMAL);
+	play_games(GHOSTS_HARD);
+	get_ghost_search_stats(&searches, &max_time, &max_steps, &cut_short, &hits, &misses);
+	printf("Search depth %u: %u searches, max %u us, max %u steps (%u cut short), corridors known %u/%u\n", 
+			GHOST_SEARCH_DEPTH, searches, max_time, max_steps, cut_short, hits, hits + misses);
+	return 0;
+}
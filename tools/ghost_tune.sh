@@ -0,0 +1,18 @@
+#!/bin/sh
+# Build and run tools/ghost_tune.c - the autopilot against normal and hard
+# ghosts. Usage: tools/ghost_tune.sh [ghost depth] [pac-man depth] [cc]
+# (the depths are GHOST_SEARCH_DEPTH and PACMAN_SEARCH_DEPTH in 
+# pacman/ghost_search.h). Extra compiler options can be given in CFLAGS,
+# e.g. CFLAGS=-DGAMES=100
+GHOST_DEPTH=${1:-2}
+PACMAN_DEPTH=${2:-1}
+CC=${3:-cc}
+DIR=$(dirname "$0")
+SRC="$DIR/../pacman"
+OUT=${TMPDIR:-/tmp}/ghost_tune.$$
+$CC -std=gnu99 -O2 -funsigned-char $CFLAGS -DGHOST_SEARCH_DEPTH="$GHOST_DEPTH" \
+	-DPACMAN_SEARCH_DEPTH="$PACMAN_DEPTH" -I"$DIR/host" -I"$SRC" -o "$OUT" \
+	"$DIR/ghost_tune.c" "$SRC/game.c" "$SRC/ghost_search.c" "$SRC/autopilot.c" "$SRC/scratch.c" \
+	"$SRC/levels.c" "$SRC/maze.c" "$SRC/score.c" || exit 1
+"$OUT"
+rm -f "$OUT"
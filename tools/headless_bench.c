@@ -0,0 +1,72 @@
+/*
+ * headless_bench.c
+ *
+ * Host benchmark of the game logic (pacman/game.c) running without any
+ * display - nothing takes the game events so nothing is drawn. A player
+ * picks a random direction every so often and games are played one after
+ * another (a new one when all lives are lost, the next level whenever one
+ * is complete) for a fixed number of ticks (milliseconds of game time).
+ * Build and run with tools/headless_bench.sh.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "game.h"
+#include "score.h"
+#include "timer0.h"
+#include "timer1.h"
+
+#define TICKS 20000000UL
+
+// Clock functions the game needs. The game time only moves on when we call
+// advance_game_time() so the clock can stay at 0.
+uint32_t get_current_time(void) {
+	return 0;
+}
+
+uint16_t get_timer1_count(void) {
+	return 0;
+}
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void) {
+	uint32_t rng = 1;
+	uint32_t games = 1, levels = 0;
+	double start, elapsed;
+
+	set_random_state(1);
+	reset_lives();
+	init_score();
+	initialise_game();
+	start = now_seconds();
+	for(uint32_t tick = 0; tick < TICKS; tick++) {
+		if(tick % 256 == 0) {
+			rng ^= rng << 13;
+			rng ^= rng >> 17;
+			rng ^= rng << 5;
+			change_pacman_direction(rng % NUM_DIRECTION_VALUES);
+		}
+		advance_game_time();
+		if(is_level_complete()) {
+			initialise_next_level();
+			levels++;
+		} else if(get_lives() == 0) {
+			reset_lives();
+			init_score();
+			initialise_game();
+			games++;
+		}
+	}
+	elapsed = now_seconds() - start;
+	printf("%lu ticks in %.2f s: %.2f million ticks/s (%lu games, %lu levels completed)\n",
+			TICKS, elapsed, TICKS / elapsed / 1e6, (unsigned long)games, (unsigned long)levels);
+	return 0;
+}
@@ -0,0 +1,11 @@
+#!/bin/sh
+# Build and run tools/headless_bench.c - the game logic without a display.
+# Usage: tools/headless_bench.sh [cc]
+CC=${1:-cc}
+DIR=$(dirname "$0")
+SRC="$DIR/../pacman"
+OUT=${TMPDIR:-/tmp}/headless_bench.$$
+$CC -std=gnu99 -O2 -funsigned-char -I"$DIR/host" -I"$SRC" -o "$OUT" "$DIR/headless_bench.c" \
+	"$SRC/game.c" "$SRC/ghost_search.c" "$SRC/levels.c" "$SRC/maze.c" "$SRC/score.c" || exit 1
+"$OUT"
+rm -f "$OUT"
@@ -0,0 +1,19 @@
+/*
+ * Stand-in for the avr-libc <avr/pgmspace.h> so that the game logic can be
+ * built and run on a host computer (see tools/headless_bench.sh). On the
+ * host, program memory is just ordinary memory.
+ */
+#ifndef HOST_PGMSPACE_H_
+#define HOST_PGMSPACE_H_
+
+#include <stdio.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+// These read whatever type the address points to, since pointers stored in
+// program memory (read with pgm_read_word() on the AVR) are wider here
+#define pgm_read_byte(address) (*(address))
+#define pgm_read_word(address) (*(address))
+#define printf_P printf
+
+#endif